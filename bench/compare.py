@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Compares two Google Benchmark JSON reports and fails on regressions.
+
+Usage: compare.py baseline.json current.json [--threshold 0.10]
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        report = json.load(f)
+    results = {}
+    for benchmark in report.get("benchmarks", []):
+        # Skip aggregates (mean, median, stddev) of repeated runs.
+        if benchmark.get("run_type") == "aggregate":
+            continue
+        results[benchmark["name"]] = benchmark
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="tolerated relative slowdown (default: 0.10)")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    regressions = 0
+    print("{:<60} {:>14} {:>14} {:>9}".format("Benchmark", "Baseline", "Current", "Change"))
+    for name, result in current.items():
+        if name not in baseline:
+            print("{:<60} {:>14} {:>14.0f} {:>9}".format(name, "-", result["real_time"], "new"))
+            continue
+
+        old = baseline[name]["real_time"]
+        new = result["real_time"]
+        if baseline[name].get("time_unit") != result.get("time_unit"):
+            print("{:<60} time units differ, skipped".format(name))
+            continue
+
+        change = (new - old) / old if old else 0.0
+        marker = ""
+        if change > args.threshold:
+            marker = "  REGRESSION"
+            regressions += 1
+        print("{:<60} {:>14.0f} {:>14.0f} {:>+8.1%}{}".format(name, old, new, change, marker))
+
+    if regressions:
+        print("\n{} benchmark(s) slower than the baseline by more than {:.0%}"
+              .format(regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
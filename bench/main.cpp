@@ -0,0 +1,573 @@
+/*
+MIT License
+
+Copyright (c) 2017 Vahan Aghajanyan <vahancho@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "polylineencoder.h"
+#include "polylinebatch.h"
+#include "polylinebinary.h"
+#include "polylinecodec.h"
+#include "polylineindex.h"
+#include "polylinefile.h"
+
+#include <benchmark/benchmark.h>
+
+#include <fstream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+enum class Data
+{
+    Realistic,  // A GPS track: small, smooth steps.
+    RandomWalk  // Large random jumps all over the globe.
+};
+
+// Returns the generated polyline of the given size, the same for each run.
+template<int Digits>
+typename gepaf::PolylineEncoder<Digits>::Polyline makePolyline(size_t size, Data data)
+{
+    using Encoder = gepaf::PolylineEncoder<Digits>;
+
+    std::mt19937 generator(static_cast<unsigned>(size));
+    std::normal_distribution<double> step(0.0, data == Data::Realistic ? 0.0002 : 20.0);
+    std::normal_distribution<double> drift(0.0, 0.00002);
+
+    typename Encoder::Polyline polyline;
+    polyline.reserve(size);
+
+    double lat = 47.2;
+    double lon = 16.6;
+    double latSpeed = 0.0;
+    double lonSpeed = 0.0;
+    for (size_t i = 0; i < size; ++i) {
+        if (data == Data::Realistic) {
+            latSpeed = 0.9 * latSpeed + 0.1 * step(generator) + drift(generator);
+            lonSpeed = 0.9 * lonSpeed + 0.1 * step(generator) + drift(generator);
+            lat += latSpeed;
+            lon += lonSpeed;
+        } else {
+            lat += step(generator);
+            lon += step(generator);
+        }
+        lat = std::max(-45.0, std::min(45.0, lat));
+        lon = std::max(-90.0, std::min(90.0, lon));
+        polyline.emplace_back(lat, lon);
+    }
+    return polyline;
+}
+
+void setCounters(benchmark::State &state, size_t points, size_t bytes)
+{
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * points));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+}
+
+// Arguments: the number of points and the kind of data.
+void polylineArguments(benchmark::internal::Benchmark *benchmark)
+{
+    for (int64_t size : { 10, 1000, 1000000 }) {
+        for (auto data : { Data::Realistic, Data::RandomWalk }) {
+            benchmark->Args({ size, static_cast<int64_t>(data) });
+        }
+    }
+}
+
+template<int Digits>
+void BM_EncodeValue(benchmark::State &state)
+{
+    // Encoding of single points, dominated by the per-value cost.
+    using Encoder = gepaf::PolylineEncoder<Digits>;
+    const auto polyline = makePolyline<Digits>(1000, static_cast<Data>(state.range(1)));
+    std::vector<typename Encoder::Polyline> singles;
+    singles.reserve(polyline.size());
+    for (const auto &point : polyline) {
+        singles.emplace_back(1, point);
+    }
+
+    char buffer[Encoder::maxEncodedSize(1)];
+    size_t bytes = 0;
+    for (auto _ : state) {
+        for (const auto &single : singles) {
+            bytes += Encoder::encode(single, buffer) - buffer;
+        }
+        benchmark::DoNotOptimize(buffer);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * singles.size()));
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+
+template<int Digits>
+void BM_Encode(benchmark::State &state)
+{
+    using Encoder = gepaf::PolylineEncoder<Digits>;
+    const auto polyline = makePolyline<Digits>(state.range(0), static_cast<Data>(state.range(1)));
+
+    std::string result;
+    for (auto _ : state) {
+        result.clear();
+        Encoder::encode(polyline, result);
+        benchmark::DoNotOptimize(result.data());
+    }
+    setCounters(state, polyline.size(), result.size());
+}
+
+template<int Digits>
+void BM_EncodeSimplified(benchmark::State &state)
+{
+    // Simplification with the tolerance of about 1 meter.
+    using Encoder = gepaf::PolylineEncoder<Digits>;
+    const auto polyline = makePolyline<Digits>(state.range(0), static_cast<Data>(state.range(1)));
+
+    std::string result;
+    for (auto _ : state) {
+        result.clear();
+        Encoder::encodeSimplified(polyline, 0.00001, result);
+        benchmark::DoNotOptimize(result.data());
+    }
+    setCounters(state, polyline.size(), result.size());
+}
+
+void BM_EncodeIncremental(benchmark::State &state)
+{
+    // A live track republished after each new point.
+    const auto polyline = makePolyline<5>(state.range(0), Data::Realistic);
+
+    size_t bytes = 0;
+    for (auto _ : state) {
+        gepaf::PolylineEncoder<> encoder(false);
+        for (const auto &point : polyline) {
+            encoder.addPoint(point.latitude(), point.longitude());
+            benchmark::DoNotOptimize(encoder.encoded().data());
+        }
+        bytes = encoder.encoded().size();
+    }
+    setCounters(state, polyline.size(), bytes);
+}
+
+// Arguments: the number of points per block.
+void BM_IndexPoint(benchmark::State &state)
+{
+    const auto encoded = gepaf::PolylineEncoder<>::encode(makePolyline<5>(1000000, Data::Realistic));
+    gepaf::PolylineIndex<> index;
+    index.build(encoded, static_cast<size_t>(state.range(0)));
+
+    std::mt19937 generator(1);
+    std::uniform_int_distribution<size_t> indices(0, index.pointCount() - 1);
+
+    gepaf::PolylineEncoder<>::PointE5 point{ 0, 0 };
+    for (auto _ : state) {
+        index.point(encoded.data(), encoded.size(), indices(generator), point);
+        benchmark::DoNotOptimize(point);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+void BM_RTreeQuery(benchmark::State &state)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    // Polylines that start at the same point and diverge, the viewport is around the start.
+    gepaf::PolylineRTree<> tree;
+    std::vector<gepaf::PolylineIndex<>> indices(1000);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        auto polyline = makePolyline<5>(1000 + i, Data::Realistic);
+        indices[i].build(Encoder::encode(polyline));
+        tree.add(i, indices[i]);
+    }
+    tree.build();
+
+    const auto bounds = Encoder::BoundingBox{ { 4499900, 1659900 }, { 4500100, 1660100 } };
+    size_t found = 0;
+    for (auto _ : state) {
+        found = 0;
+        tree.query(bounds, [&found](const gepaf::PolylineRTree<>::Entry &) { ++found; });
+        benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.counters["found"] = static_cast<double>(found);
+    state.counters["boxes"] = static_cast<double>(tree.size());
+}
+
+// Arguments: the binary mode and the kind of data.
+void BM_FromPolyline(benchmark::State &state)
+{
+    using Binary = gepaf::PolylineBinary<>;
+    const auto mode = static_cast<Binary::Mode>(state.range(0));
+    const auto encoded = gepaf::PolylineEncoder<>::encode(makePolyline<5>(100000, static_cast<Data>(state.range(1))));
+
+    std::string binary;
+    for (auto _ : state) {
+        binary.clear();
+        Binary::fromPolyline(encoded.data(), encoded.size(), mode, binary);
+        benchmark::DoNotOptimize(binary.data());
+    }
+    setCounters(state, 100000, encoded.size());
+    state.counters["ratio"] = static_cast<double>(binary.size()) / static_cast<double>(encoded.size());
+}
+
+void BM_ToPolyline(benchmark::State &state)
+{
+    using Binary = gepaf::PolylineBinary<>;
+    const auto mode = static_cast<Binary::Mode>(state.range(0));
+    const auto encoded = gepaf::PolylineEncoder<>::encode(makePolyline<5>(100000, static_cast<Data>(state.range(1))));
+    const auto binary = Binary::fromPolyline(encoded, mode);
+
+    std::string result;
+    for (auto _ : state) {
+        result.clear();
+        Binary::toPolyline(binary.data(), binary.size(), result);
+        benchmark::DoNotOptimize(result.data());
+    }
+    setCounters(state, 100000, binary.size());
+}
+
+void BM_Codec(benchmark::State &state)
+{
+    // Arguments: the precision and the dimensions, with elevations as the third values.
+    const int precision = static_cast<int>(state.range(0));
+    const int dimensions = static_cast<int>(state.range(1));
+    const gepaf::PolylineCodec codec(precision, dimensions, 1);
+
+    const auto polyline = makePolyline<5>(100000, Data::Realistic);
+    std::vector<double> values;
+    for (size_t i = 0; i < polyline.size(); ++i) {
+        values.push_back(polyline[i].latitude());
+        values.push_back(polyline[i].longitude());
+        if (dimensions > 2) {
+            values.push_back(100.0 + static_cast<double>(i % 1000) / 10.0);
+        }
+    }
+
+    std::string result;
+    for (auto _ : state) {
+        result.clear();
+        codec.encode(values.data(), polyline.size(), result);
+        const auto decoded = codec.decode(result);
+        benchmark::DoNotOptimize(decoded.data());
+    }
+    setCounters(state, polyline.size(), result.size());
+}
+
+void BM_BboxDecoded(benchmark::State &state)
+{
+    // The bounding box of the decoded points.
+    const auto encoded = gepaf::PolylineEncoder<>::encode(makePolyline<5>(state.range(0), Data::Realistic));
+
+    for (auto _ : state) {
+        const auto polyline = gepaf::PolylineEncoder<>::decode(encoded);
+        double minLat = 90.0;
+        double maxLat = -90.0;
+        double minLon = 180.0;
+        double maxLon = -180.0;
+        for (const auto &point : polyline) {
+            minLat = std::min(minLat, point.latitude());
+            maxLat = std::max(maxLat, point.latitude());
+            minLon = std::min(minLon, point.longitude());
+            maxLon = std::max(maxLon, point.longitude());
+        }
+        benchmark::DoNotOptimize(minLat + maxLat + minLon + maxLon);
+    }
+    setCounters(state, state.range(0), encoded.size());
+}
+
+void BM_Bbox(benchmark::State &state)
+{
+    const auto encoded = gepaf::PolylineEncoder<>::encode(makePolyline<5>(state.range(0), Data::Realistic));
+
+    gepaf::PolylineEncoder<>::BoundingBox box{};
+    for (auto _ : state) {
+        gepaf::PolylineEncoder<>::bbox(encoded, box);
+        benchmark::DoNotOptimize(box);
+    }
+    setCounters(state, state.range(0), encoded.size());
+}
+
+void BM_LengthMeters(benchmark::State &state)
+{
+    const auto encoded = gepaf::PolylineEncoder<>::encode(makePolyline<5>(state.range(0), Data::Realistic));
+
+    double meters = 0.0;
+    for (auto _ : state) {
+        gepaf::PolylineEncoder<>::lengthMeters(encoded, meters);
+        benchmark::DoNotOptimize(meters);
+    }
+    setCounters(state, state.range(0), encoded.size());
+}
+
+void BM_PointCount(benchmark::State &state)
+{
+    const auto encoded = gepaf::PolylineEncoder<>::encode(makePolyline<5>(state.range(0), Data::Realistic));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gepaf::PolylineEncoder<>::pointCount(encoded));
+    }
+    setCounters(state, state.range(0), encoded.size());
+}
+
+// A heavy user-defined point type.
+struct Waypoint
+{
+    double latitude;
+    double longitude;
+    double elevation;
+    double speed;
+    char name[64];
+};
+
+template<int Digits>
+void BM_EncodeRange(benchmark::State &state)
+{
+    using Encoder = gepaf::PolylineEncoder<Digits>;
+    const auto polyline = makePolyline<Digits>(state.range(0), static_cast<Data>(state.range(1)));
+
+    std::vector<Waypoint> waypoints(polyline.size());
+    for (size_t i = 0; i < polyline.size(); ++i) {
+        waypoints[i].latitude = polyline[i].latitude();
+        waypoints[i].longitude = polyline[i].longitude();
+    }
+
+    std::string result;
+    for (auto _ : state) {
+        result = Encoder::encode(waypoints.begin(), waypoints.end(), &Waypoint::latitude, &Waypoint::longitude);
+        benchmark::DoNotOptimize(result.data());
+    }
+    setCounters(state, waypoints.size(), result.size());
+}
+
+// A point type that is expensive to copy.
+struct NamedWaypoint
+{
+    double latitude;
+    double longitude;
+    std::string name;
+};
+
+void BM_EncodeRangeNamed(benchmark::State &state)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+    const auto polyline = makePolyline<5>(state.range(0), Data::Realistic);
+
+    std::vector<NamedWaypoint> waypoints;
+    for (const auto &point : polyline) {
+        waypoints.push_back(NamedWaypoint{ point.latitude(), point.longitude(),
+                                           "A waypoint name of 64 characters, too long to be stored inline" });
+    }
+
+    std::string result;
+    for (auto _ : state) {
+        result.clear();
+        Encoder::encode(waypoints.cbegin(), waypoints.cend(),
+                        [](const NamedWaypoint &waypoint) { return waypoint.latitude; },
+                        [](const NamedWaypoint &waypoint) { return waypoint.longitude; }, result);
+        benchmark::DoNotOptimize(result.data());
+    }
+    setCounters(state, waypoints.size(), result.size());
+}
+
+template<int Digits>
+void BM_Decode(benchmark::State &state)
+{
+    using Encoder = gepaf::PolylineEncoder<Digits>;
+    const auto encoded = Encoder::encode(makePolyline<Digits>(state.range(0), static_cast<Data>(state.range(1))));
+
+    size_t points = 0;
+    for (auto _ : state) {
+        const auto polyline = Encoder::decode(encoded);
+        points = polyline.size();
+        benchmark::DoNotOptimize(polyline.data());
+    }
+    setCounters(state, points, encoded.size());
+}
+
+template<int Digits>
+void BM_DecodeE5(benchmark::State &state)
+{
+    using Encoder = gepaf::PolylineEncoder<Digits>;
+    const auto encoded = Encoder::encode(makePolyline<Digits>(state.range(0), static_cast<Data>(state.range(1))));
+
+    size_t points = 0;
+    for (auto _ : state) {
+        const auto polyline = Encoder::decodeE5(encoded);
+        points = polyline.size();
+        benchmark::DoNotOptimize(polyline.data());
+    }
+    setCounters(state, points, encoded.size());
+}
+
+// Arguments: the number of threads.
+void threadArguments(benchmark::internal::Benchmark *benchmark)
+{
+    const int64_t threads = std::max(1U, std::thread::hardware_concurrency());
+    for (int64_t i = 1; i < threads; i *= 2) {
+        benchmark->Arg(i);
+    }
+    benchmark->Arg(threads);
+}
+
+void BM_BatchEncode(benchmark::State &state)
+{
+    // Many independent trips of various lengths.
+    std::vector<gepaf::PolylineEncoder<>::Polyline> polylines;
+    size_t points = 0;
+    for (size_t i = 0; i < 2000; ++i) {
+        polylines.push_back(makePolyline<5>(100 + i % 1000, Data::Realistic));
+        points += polylines.back().size();
+    }
+
+    gepaf::ThreadPool pool(state.range(0));
+    size_t bytes = 0;
+    for (auto _ : state) {
+        const auto encoded = gepaf::PolylineBatch<>::encode(polylines.begin(), polylines.end(), pool);
+        bytes = encoded.data.size();
+        benchmark::DoNotOptimize(encoded.data.data());
+    }
+    setCounters(state, points, bytes);
+}
+
+void BM_BatchDecode(benchmark::State &state)
+{
+    std::vector<std::string> strings;
+    size_t points = 0;
+    for (size_t i = 0; i < 2000; ++i) {
+        const auto polyline = makePolyline<5>(100 + i % 1000, Data::Realistic);
+        strings.push_back(gepaf::PolylineEncoder<>::encode(polyline));
+        points += polyline.size();
+    }
+
+    gepaf::ThreadPool pool(state.range(0));
+    size_t bytes = 0;
+    for (const auto &string : strings) {
+        bytes += string.size();
+    }
+    for (auto _ : state) {
+        const auto decoded = gepaf::PolylineBatch<>::decode(strings.begin(), strings.end(), pool);
+        benchmark::DoNotOptimize(decoded.points.data());
+    }
+    setCounters(state, points, bytes);
+}
+
+void BM_DecodeParallel(benchmark::State &state)
+{
+    const auto encoded = gepaf::PolylineEncoder<>::encode(makePolyline<5>(1000000, Data::Realistic));
+
+    gepaf::ThreadPool pool(state.range(0));
+    size_t points = 0;
+    for (auto _ : state) {
+        const auto polyline = gepaf::PolylineBatch<>::decodeParallel(encoded, pool);
+        points = polyline.size();
+        benchmark::DoNotOptimize(polyline.data());
+    }
+    setCounters(state, points, encoded.size());
+}
+
+// Returns the path of the file of many newline-delimited polylines, written once.
+const std::string &polylineFile()
+{
+    static const std::string path = [] {
+        const std::string name = "polybench-polylines.txt";
+        gepaf::PolylineWriter<> writer;
+        writer.open(name);
+        for (size_t i = 0; i < 20000; ++i) {
+            writer.write(makePolyline<5>(10 + i % 200, Data::Realistic));
+        }
+        writer.close();
+        return name;
+    }();
+    return path;
+}
+
+void BM_FilePerLine(benchmark::State &state)
+{
+    // Reading the lines into strings and decoding each of them.
+    const std::string &path = polylineFile();
+    size_t points = 0;
+    for (auto _ : state) {
+        std::ifstream file(path, std::ios::binary);
+        std::string line;
+        points = 0;
+        while (std::getline(file, line)) {
+            const auto polyline = gepaf::PolylineEncoder<>::decode(line);
+            points += polyline.size();
+            benchmark::DoNotOptimize(polyline.data());
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * points));
+}
+
+void BM_FileMapped(benchmark::State &state)
+{
+    const std::string &path = polylineFile();
+    size_t points = 0;
+    for (auto _ : state) {
+        gepaf::PolylineReader<> reader;
+        reader.open(path);
+        gepaf::PolylineEncoder<>::Polyline polyline;
+        gepaf::PolylineEncoder<>::Result result{};
+        points = 0;
+        while (reader.next(polyline, result)) {
+            points += polyline.size();
+            benchmark::DoNotOptimize(polyline.data());
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * points));
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_EncodeValue, 5)->Args({ 1000, 0 })->Args({ 1000, 1 });
+
+BENCHMARK_TEMPLATE(BM_Encode, 5)->Apply(polylineArguments);
+BENCHMARK_TEMPLATE(BM_Encode, 6)->Apply(polylineArguments);
+BENCHMARK_TEMPLATE(BM_Encode, 7)->Apply(polylineArguments);
+
+BENCHMARK_TEMPLATE(BM_EncodeRange, 5)->Apply(polylineArguments);
+BENCHMARK(BM_EncodeRangeNamed)->Arg(1000)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_EncodeSimplified, 5)->Apply(polylineArguments);
+BENCHMARK(BM_Codec)->Args({ 5, 2 })->Args({ 4, 2 })->Args({ 5, 3 });
+BENCHMARK(BM_FromPolyline)->Args({ 0, 0 })->Args({ 1, 0 })->Args({ 0, 1 })->Args({ 1, 1 });
+BENCHMARK(BM_ToPolyline)->Args({ 0, 0 })->Args({ 1, 0 });
+BENCHMARK(BM_IndexPoint)->Arg(16)->Arg(64)->Arg(256);
+BENCHMARK(BM_RTreeQuery);
+BENCHMARK(BM_BboxDecoded)->Arg(1000)->Arg(1000000);
+BENCHMARK(BM_Bbox)->Arg(1000)->Arg(1000000);
+BENCHMARK(BM_LengthMeters)->Arg(1000)->Arg(1000000);
+BENCHMARK(BM_PointCount)->Arg(1000)->Arg(1000000);
+BENCHMARK(BM_EncodeIncremental)->Arg(1000)->Arg(100000);
+
+BENCHMARK_TEMPLATE(BM_Decode, 5)->Apply(polylineArguments);
+BENCHMARK_TEMPLATE(BM_Decode, 6)->Apply(polylineArguments);
+BENCHMARK_TEMPLATE(BM_Decode, 7)->Apply(polylineArguments);
+
+BENCHMARK_TEMPLATE(BM_DecodeE5, 5)->Apply(polylineArguments);
+
+BENCHMARK(BM_BatchEncode)->Apply(threadArguments)->UseRealTime();
+BENCHMARK(BM_BatchDecode)->Apply(threadArguments)->UseRealTime();
+BENCHMARK(BM_DecodeParallel)->Apply(threadArguments)->UseRealTime();
+
+BENCHMARK(BM_FilePerLine);
+BENCHMARK(BM_FileMapped);
+
+BENCHMARK_MAIN();
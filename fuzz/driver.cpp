@@ -0,0 +1,75 @@
+// polylinediff: the randomized differential test of the encoding and decoding paths.
+//
+// Generates random walks, edge values, arbitrary coordinates, garbage, mutated
+// and long polylines for all precisions, checks the paths against the reference
+// codec and reports the throughput of the checks.
+
+#include "polylinedifferential.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace
+{
+
+void printUsage()
+{
+    std::fprintf(stderr,
+                 "Usage: polylinediff [-n ITERATIONS] [-t SECONDS] [-s SEED]\n"
+                 "\n"
+                 "Options:\n"
+                 "  -n ITERATIONS The number of the checked inputs (default: 10000)\n"
+                 "  -t SECONDS    Stop after the given time, even if not all inputs are checked\n"
+                 "  -s SEED       The seed of the random generator (default: random)\n");
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    unsigned long long iterations = 10000;
+    double seconds = 0.0;
+    unsigned long seed = std::random_device{}();
+
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && std::strcmp(argv[i], "-n") == 0) {
+            iterations = std::strtoull(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "-t") == 0) {
+            seconds = std::strtod(argv[++i], nullptr);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "-s") == 0) {
+            seed = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::printf("Seed %lu\n", seed);
+    std::mt19937 generator(static_cast<std::mt19937::result_type>(seed));
+
+    const auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    size_t bytes = 0;
+    unsigned long long checked = 0;
+    while (checked < iterations) {
+        const std::string error = gepaf::checkDifferential(generator, bytes);
+        ++checked;
+        if (!error.empty()) {
+            std::fprintf(stderr, "Mismatch at input %llu: %s\n", checked, error.c_str());
+            return EXIT_FAILURE;
+        }
+
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (seconds > 0.0 && elapsed >= seconds) {
+            break;
+        }
+    }
+
+    std::printf("Checked %llu inputs, %zu bytes in %.2f s: %.0f inputs/s, %.2f MB/s\n",
+                checked, bytes, elapsed, checked / elapsed, bytes / elapsed / 1e6);
+    return EXIT_SUCCESS;
+}
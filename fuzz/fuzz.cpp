@@ -0,0 +1,57 @@
+// polylinefuzz: the libFuzzer target of the differential checks.
+//
+// The input is decoded as an encoded polyline with all precisions, and is also
+// read as little-endian 32-bit coordinates that are encoded by all encoders.
+// Its halves are joined, sliced and spliced. Any mismatch with the reference
+// codec aborts with its description.
+
+#include "polylinedifferential.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace
+{
+
+template<int Digits>
+void check(const uint8_t *data, size_t size)
+{
+    using Differential = gepaf::PolylineDifferential<Digits>;
+
+    std::string error = Differential::checkDecode(reinterpret_cast<const char *>(data), size);
+    if (error.empty()) {
+        typename Differential::PolylineE5 points;
+        for (size_t i = 0; i + 8 <= size; i += 8) {
+            uint32_t values[2] = { 0, 0 };
+            for (int byte = 0; byte < 8; ++byte) {
+                values[byte / 4] |= static_cast<uint32_t>(data[i + byte]) << (8 * (byte % 4));
+            }
+            points.push_back({ static_cast<int32_t>(values[0]), static_cast<int32_t>(values[1]) });
+        }
+        error = Differential::checkEncode(points);
+    }
+    if (error.empty() && size >= 2) {
+        // The first two bytes give the edited range, the rest is split into two polylines.
+        const std::string rest(reinterpret_cast<const char *>(data) + 2, size - 2);
+        const size_t middle = rest.size() / 2;
+        error = Differential::checkEdit(rest.substr(0, middle), rest.substr(middle), data[0] % 64, data[1] % 64);
+    }
+
+    if (!error.empty()) {
+        std::fprintf(stderr, "Precision %d: %s\n", Digits, error.c_str());
+        std::abort();
+    }
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    check<1>(data, size);
+    check<5>(data, size);
+    check<6>(data, size);
+    check<7>(data, size);
+    return 0;
+}
@@ -0,0 +1,840 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2017 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef POLYLINEDIFFERENTIAL_H
+#define POLYLINEDIFFERENTIAL_H
+
+#include "polylinebatch.h"
+#include "polylinebinary.h"
+#include "polylinecodec.h"
+#include "polylinefile.h"
+#include "polylineindex.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace gepaf
+{
+
+//! Checks the encoding and decoding paths of the library against a plain scalar reference.
+/*!
+    The reference codec follows the algorithm definition character by character,
+    without word-at-a-time decoding, batching or any other shortcut of the library,
+    so that the fast paths are verified by a second, independent implementation.
+    Each check returns an empty string if all paths agree, or the description of
+    the first mismatch.
+
+    The paths include the parallel PolylineBatch and the PolylineReader records.
+    PolylineBatch::decodeParallel() splits the strings of 64 KiB and longer only,
+    which the Long inputs are. The compile-time encoding, pointCount() and
+    lengthMeters() are not checked.
+
+    The edits of encoded polylines are checked against the decoded points edited
+    in a vector, and the simplification against the recursive Douglas-Peucker
+    algorithm. The checks are shared by the unit tests, the randomized driver
+    and the libFuzzer target.
+*/
+template<int Digits = 5>
+class PolylineDifferential
+{
+public:
+    using Encoder = PolylineEncoder<Digits>;
+    using Point = typename Encoder::Point;
+    using Polyline = typename Encoder::Polyline;
+    using PointE5 = typename Encoder::PointE5;
+    using PolylineE5 = typename Encoder::PolylineE5;
+    using Status = typename Encoder::Status;
+    using Result = typename Encoder::Result;
+
+    //! The kinds of the generated inputs.
+    enum class Kind
+    {
+        RandomWalk,   ///< A long track of small steps.
+        EdgeValues,   ///< The points at and around the ±90.0° and ±180.0° limits and zero.
+        RandomValues, ///< Arbitrary 32-bit coordinates, mostly out of range.
+        Garbage,      ///< Random characters.
+        Mutated,      ///< A valid polyline with truncations and replaced characters.
+        Long,         ///< Random walks longer than the parallel decoding threshold, sometimes mutated.
+        Count
+    };
+
+    //! Decodes the \p size characters of \p data into the \p points, one character at a time.
+    static Result referenceDecode(const char *data, size_t size, PolylineE5 &points);
+
+    //! Returns the encoded \p points, one character at a time.
+    static std::string referenceEncode(const PolylineE5 &points);
+
+    //! Returns true if the point is within ±90.0° latitude and ±180.0° longitude.
+    static bool inRange(const PointE5 &point);
+
+    //! Checks all decoding paths with the \p size characters of \p data.
+    static std::string checkDecode(const char *data, size_t size);
+
+    //! Checks all encoding paths with the \p points, including the simplification.
+    /*!
+        The paths that take the coordinates in degrees are checked only if all
+        points are within the range. The simplification, that takes quadratic time
+        for the long random tracks, is checked for up to s_maxSimplifiedSize points.
+    */
+    static std::string checkEncode(const PolylineE5 &points);
+
+    //! Checks concat(), slice() and splice() of the encoded polylines \p first and \p second.
+    /*!
+        The results must be equal to the reference encoding of the decoded points
+        edited in a vector, or be empty if the edited polylines are invalid.
+        \param begin The first point of the range to slice and to replace.
+        \param end   The point past the range.
+    */
+    static std::string checkEdit(const std::string &first, const std::string &second, size_t begin, size_t end);
+
+    //! Returns the points of the given \p kind.
+    static PolylineE5 makePoints(std::mt19937 &generator, Kind kind);
+
+    //! Returns the string of the given \p kind, derived from the \p points.
+    static std::string makeString(std::mt19937 &generator, Kind kind, const PolylineE5 &points);
+
+    //! Generates an input of a random kind and checks all paths with it.
+    /*!
+        The Long inputs, that take much longer to check, are generated rarely.
+        \param bytes Is incremented by the size of the checked encoded polyline.
+    */
+    static std::string check(std::mt19937 &generator, size_t &bytes);
+
+private:
+    static constexpr const int64_t s_maxLatitude = 90LL * Encoder::Precision::Value;
+    static constexpr const int64_t s_maxLongitude = 180LL * Encoder::Precision::Value;
+
+    //! The most points to check the simplification with.
+    static constexpr const size_t s_maxSimplifiedSize = 1000;
+
+    //! The size of the strings that PolylineBatch::decodeParallel() decodes in parallel.
+    static constexpr const size_t s_parallelSize = 1 << 16;
+
+    //! Returns the threads for PolylineBatch, that are more than one to take the parallel paths.
+    static ThreadPool &threadPool();
+
+    //! Returns the description of the mismatched \p result.
+    static std::string mismatch(const char *path, const Result &result, const Result &expected);
+
+    //! Returns true if both results are equal.
+    static bool same(const Result &first, const Result &second);
+
+    //! Returns true if the points are equal to the reference ones.
+    static bool same(const PolylineE5 &points, const PolylineE5 &expected);
+    static bool same(const Polyline &points, const PolylineE5 &expected);
+
+    //! Returns the coordinates as interleaved degrees for PolylineCodec.
+    static std::vector<double> toValues(const PolylineE5 &points);
+
+    //! Marks the points of the [\p first, \p last] range kept by the Douglas-Peucker
+    //! algorithm with the squared \p tolerance, recursively.
+    static void referenceSimplify(const PolylineE5 &points, size_t first, size_t last, double tolerance,
+                                  std::vector<bool> &keep);
+
+    //! Returns true if the edited polyline \p result has the \p expected points, or is empty if not \p valid.
+    /*!
+        The copied characters are not re-encoded, so the values that the source
+        polyline encodes with redundant chunks are compared by their points.
+    */
+    static bool sameEdit(const std::string &result, bool valid, const PolylineE5 &expected);
+
+    //! Returns the points of the [\p begin, \p end) range.
+    static PolylineE5 range(const PolylineE5 &points, size_t begin, size_t end);
+};
+
+//! Generates an input for a random precision and checks all paths with it.
+/*!
+    \param bytes Is incremented by the size of the checked encoded polyline.
+    \returns An empty string if all paths agree, or the description of the first mismatch.
+*/
+inline std::string checkDifferential(std::mt19937 &generator, size_t &bytes);
+
+///////////////////////////////////////////////////////////////////////////////
+
+template<int Digits>
+typename PolylineDifferential<Digits>::Result
+PolylineDifferential<Digits>::referenceDecode(const char *data, size_t size, PolylineE5 &points)
+{
+    Result result{ Status::Ok, size, 0 };
+    uint32_t coordinates[2] = { 0, 0 };
+    size_t index = 0;
+
+    while (index < size) {
+        const size_t point = index;
+        for (auto &coordinate : coordinates) {
+            const size_t start = index;
+            uint32_t value = 0;
+            int shift = 0;
+            while (true) {
+                if (index == size) {
+                    return Result{ Status::Incomplete, start, result.pointCount };
+                }
+                const int c = static_cast<unsigned char>(data[index]) - 63;
+                if (c < 0 || c > 63) {
+                    return Result{ Status::InvalidCharacter, index, result.pointCount };
+                }
+                if (shift == 30 && c > 3) {
+                    return Result{ Status::Overflow, index, result.pointCount };
+                }
+                value |= static_cast<uint32_t>(c & 0x1f) << shift;
+                shift += 5;
+                ++index;
+                if (c < 0x20) {
+                    break;
+                }
+            }
+            const uint32_t delta = (value & 1) ? ~(value >> 1) : (value >> 1);
+            coordinate += delta;
+        }
+
+        const PointE5 decoded{ static_cast<int32_t>(coordinates[0]), static_cast<int32_t>(coordinates[1]) };
+        if (!inRange(decoded)) {
+            return Result{ Status::OutOfRange, point, result.pointCount };
+        }
+        points.push_back(decoded);
+        ++result.pointCount;
+    }
+    return result;
+}
+
+template<int Digits>
+std::string PolylineDifferential<Digits>::referenceEncode(const PolylineE5 &points)
+{
+    std::string result;
+    uint32_t previous[2] = { 0, 0 };
+    for (const auto &point : points) {
+        const uint32_t current[2] = { static_cast<uint32_t>(point.latitude),
+                                      static_cast<uint32_t>(point.longitude) };
+        for (int i = 0; i < 2; ++i) {
+            const uint32_t delta = current[i] - previous[i];
+            uint32_t value = (delta << 1) ^ ((delta & 0x80000000u) ? 0xffffffffu : 0u);
+            while (value >= 0x20) {
+                result.push_back(static_cast<char>((0x20 | (value & 0x1f)) + 63));
+                value >>= 5;
+            }
+            result.push_back(static_cast<char>(value + 63));
+            previous[i] = current[i];
+        }
+    }
+    return result;
+}
+
+template<int Digits>
+bool PolylineDifferential<Digits>::inRange(const PointE5 &point)
+{
+    return point.latitude >= -s_maxLatitude && point.latitude <= s_maxLatitude &&
+           point.longitude >= -s_maxLongitude && point.longitude <= s_maxLongitude;
+}
+
+template<int Digits>
+std::string PolylineDifferential<Digits>::checkDecode(const char *data, size_t size)
+{
+    const std::string coords(data, size);
+
+    PolylineE5 expected;
+    const Result reference = referenceDecode(data, size, expected);
+
+    PolylineE5 points;
+    Result result = Encoder::decodeE5(data, size, points);
+    if (!same(result, reference) || !same(points, expected)) {
+        return mismatch("decodeE5", result, reference);
+    }
+
+    result = Encoder::validate(data, size);
+    if (!same(result, reference)) {
+        return mismatch("validate", result, reference);
+    }
+
+    Polyline polyline;
+    result = Encoder::decode(data, size, polyline);
+    if (!same(result, reference) || !same(polyline, expected)) {
+        return mismatch("decode", result, reference);
+    }
+
+    // The convenience functions return nothing for invalid polylines.
+    const PolylineE5 decoded = expected;
+    if (!reference) {
+        expected.clear();
+    }
+    if (!same(Encoder::decodeE5(coords), expected)) {
+        return "decodeE5(string) points differ";
+    }
+    if (!same(Encoder::decode(coords), expected)) {
+        return "decode(string) points differ";
+    }
+
+    const auto columns = Encoder::decodeColumnsE5(coords);
+    if (columns.latitudes.size() != expected.size() || columns.longitudes.size() != expected.size()) {
+        return "decodeColumnsE5 sizes differ";
+    }
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (columns.latitudes[i] != expected[i].latitude || columns.longitudes[i] != expected[i].longitude) {
+            return "decodeColumnsE5 points differ";
+        }
+    }
+
+    typename Encoder::BoundingBox box{};
+    result = Encoder::bbox(coords, box);
+    if (result.status != reference.status) {
+        return mismatch("bbox", result, reference);
+    }
+    if (reference && !expected.empty()) {
+        auto expectedBox = typename Encoder::BoundingBox{ expected.front(), expected.front() };
+        for (const auto &point : expected) {
+            expectedBox.min.latitude = std::min(expectedBox.min.latitude, point.latitude);
+            expectedBox.min.longitude = std::min(expectedBox.min.longitude, point.longitude);
+            expectedBox.max.latitude = std::max(expectedBox.max.latitude, point.latitude);
+            expectedBox.max.longitude = std::max(expectedBox.max.longitude, point.longitude);
+        }
+        if (box.min.latitude != expectedBox.min.latitude || box.min.longitude != expectedBox.min.longitude ||
+            box.max.latitude != expectedBox.max.latitude || box.max.longitude != expectedBox.max.longitude) {
+            return "bbox differs";
+        }
+    }
+
+    if (reference) {
+        PolylineE5 viewed;
+        PolylineView<Digits> view(data, size);
+        for (auto it = view.begin(); it != view.end(); ++it) {
+            viewed.push_back(it.e5());
+        }
+        if (!same(viewed, expected)) {
+            return "PolylineView points differ";
+        }
+    }
+
+    // Feed the streaming decoder in chunks of all sizes, so that values and points are split anywhere.
+    for (size_t chunk = 1; chunk <= 9; chunk += 4) {
+        PolylineDecoder<Digits> decoder;
+        PolylineE5 streamed;
+        for (size_t offset = 0; offset < size; offset += chunk) {
+            decoder.decodeE5(data + offset, std::min(chunk, size - offset), [&streamed](const PointE5 &point) {
+                streamed.push_back(point);
+            });
+        }
+        if (decoder.isComplete() != static_cast<bool>(reference) ||
+            decoder.pointCount() != reference.pointCount) {
+            return "PolylineDecoder result differs";
+        }
+        if (!same(streamed, decoded)) {
+            return "PolylineDecoder points differ";
+        }
+    }
+
+    // The records are read from both kinds of line breaks.
+    if (std::find(coords.begin(), coords.end(), '\n') == coords.end()) {
+        const std::string lines = coords + "\r\n" + coords + "\n";
+        PolylineReader<Digits> reader(lines.data(), lines.size());
+        PolylineE5 record;
+        if (!reader.next(record, result) || !same(result, reference) || !same(record, decoded)) {
+            return mismatch("PolylineReader::next", result, reference);
+        }
+        Polyline degrees;
+        if (!reader.next(degrees, result) || !same(result, reference) || !same(degrees, decoded)) {
+            return mismatch("PolylineReader::next(Polyline)", result, reference);
+        }
+        if (reader.next(record, result) || reader.lineNumber() != 2) {
+            return "PolylineReader records differ";
+        }
+    }
+
+    // Batches of the same polyline, decoded as invalid polylines are, to nothing.
+    const std::vector<std::string> batch(3, coords);
+    const auto decodedBatch = PolylineBatch<Digits>::decode(batch.begin(), batch.end(), threadPool());
+    if (decodedBatch.size() != batch.size()) {
+        return "PolylineBatch::decode size differs";
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (!same(decodedBatch.at(i), expected)) {
+            return "PolylineBatch::decode points differ";
+        }
+    }
+    if (!same(PolylineBatch<Digits>::decodeParallel(coords, threadPool()), expected)) {
+        return size < s_parallelSize ? "PolylineBatch::decodeParallel points differ"
+                                     : "PolylineBatch::decodeParallel points differ in parallel";
+    }
+
+    PolylineIndex<Digits> index;
+    result = index.build(data, size, 3);
+    if (!same(result, reference)) {
+        return mismatch("PolylineIndex::build", result, reference);
+    }
+    if (reference) {
+        for (size_t i = 0; i < expected.size(); i += 1 + i / 2) {
+            PointE5 point{};
+            if (!index.point(data, size, i, point) || point.latitude != expected[i].latitude ||
+                point.longitude != expected[i].longitude) {
+                return "PolylineIndex::point differs";
+            }
+        }
+    }
+
+    // The binary polylines store the canonical encoding of the points.
+    for (auto mode : { PolylineBinary<Digits>::Mode::Delta, PolylineBinary<Digits>::Mode::DeltaOfDelta }) {
+        std::string binary;
+        result = PolylineBinary<Digits>::fromPolyline(data, size, mode, binary);
+        if (!same(result, reference)) {
+            return mismatch("PolylineBinary::fromPolyline", result, reference);
+        }
+        if (reference && PolylineBinary<Digits>::toPolyline(binary) != referenceEncode(expected)) {
+            return "PolylineBinary round trip differs";
+        }
+    }
+
+    std::vector<double> values;
+    if (PolylineCodec(Digits).decode(data, size, values) != static_cast<bool>(reference)) {
+        return "PolylineCodec::decode status differs";
+    }
+    if (reference && values != toValues(expected)) {
+        return "PolylineCodec::decode values differ";
+    }
+
+    return {};
+}
+
+template<int Digits>
+std::string PolylineDifferential<Digits>::checkEncode(const PolylineE5 &points)
+{
+    const std::string expected = referenceEncode(points);
+
+    if (Encoder::encodeE5(points) != expected) {
+        return "encodeE5 differs";
+    }
+
+    std::string iterated;
+    Encoder::encodeE5(points, std::back_inserter(iterated));
+    if (iterated != expected) {
+        return "encodeE5(OutputIt) differs";
+    }
+
+    std::vector<int32_t> latitudes;
+    std::vector<int32_t> longitudes;
+    for (const auto &point : points) {
+        latitudes.push_back(point.latitude);
+        longitudes.push_back(point.longitude);
+    }
+    if (Encoder::encodeColumnsE5(latitudes.data(), longitudes.data(), points.size()) != expected) {
+        return "encodeColumnsE5 differs";
+    }
+
+    Encoder incremental(false);
+    for (const auto &point : points) {
+        incremental.addPointE5(point.latitude, point.longitude);
+    }
+    if (incremental.encoded() != expected) {
+        return "addPointE5 differs";
+    }
+
+    // The tolerances from none to larger than the whole range, in decimal degrees.
+    const double tolerances[] = { 0.0, 10.0 / Encoder::Precision::Value, 0.5, 1000.0 };
+    std::vector<PolylineE5> simplified;
+    for (const double tolerance : tolerances) {
+        if (points.size() > s_maxSimplifiedSize) {
+            break;
+        }
+        std::vector<bool> keep(points.size(), false);
+        if (!points.empty()) {
+            keep.front() = keep.back() = true;
+            const double scaled = tolerance * Encoder::Precision::Value;
+            referenceSimplify(points, 0, points.size() - 1, scaled * scaled, keep);
+        }
+        PolylineE5 kept;
+        for (size_t i = 0; i < points.size(); ++i) {
+            if (keep[i]) {
+                kept.push_back(points[i]);
+            }
+        }
+        if (Encoder::encodeSimplifiedE5(points, tolerance) != referenceEncode(kept)) {
+            return "encodeSimplifiedE5 differs";
+        }
+        simplified.push_back(kept);
+    }
+
+    for (const auto &point : points) {
+        if (!inRange(point)) {
+            return {};
+        }
+    }
+
+    // The binary polylines are decoded with the range checks.
+    const auto binary = PolylineBinary<Digits>::encodeE5(points, PolylineBinary<Digits>::Mode::DeltaOfDelta);
+    if (PolylineBinary<Digits>::toPolyline(binary) != expected) {
+        return "PolylineBinary::toPolyline differs";
+    }
+
+    Polyline polyline;
+    for (const auto &point : points) {
+        polyline.push_back(Point::fromE5(point.latitude, point.longitude));
+    }
+    if (Encoder::encode(polyline) != expected) {
+        return "encode differs";
+    }
+    if (Encoder::encodedSize(polyline) != expected.size()) {
+        return "encodedSize differs";
+    }
+
+    std::vector<char> buffer(Encoder::maxEncodedSize(polyline.size()));
+    char *end = Encoder::encode(polyline, buffer.data());
+    if (std::string(buffer.data(), end) != expected) {
+        return "encode(char *) differs";
+    }
+
+    const auto ranged = Encoder::encode(points.begin(), points.end(),
+                                        [](const PointE5 &point) { return Encoder::fromE5(point.latitude); },
+                                        [](const PointE5 &point) { return Encoder::fromE5(point.longitude); });
+    if (ranged != expected) {
+        return "encode(range) differs";
+    }
+
+    if (PolylineCodec(Digits).encode(toValues(points)) != expected) {
+        return "PolylineCodec::encode differs";
+    }
+
+    for (size_t i = 0; i < simplified.size(); ++i) {
+        if (Encoder::encodeSimplified(polyline, tolerances[i]) != referenceEncode(simplified[i])) {
+            return "encodeSimplified differs";
+        }
+    }
+
+    const std::vector<Polyline> batch = { polyline, Polyline(), polyline };
+    const auto encodedBatch = PolylineBatch<Digits>::encode(batch.begin(), batch.end(), threadPool());
+    if (encodedBatch.size() != batch.size() || encodedBatch.at(0) != expected || !encodedBatch.at(1).empty() ||
+        encodedBatch.at(2) != expected) {
+        return "PolylineBatch::encode differs";
+    }
+
+    return {};
+}
+
+template<int Digits>
+std::string PolylineDifferential<Digits>::checkEdit(const std::string &first, const std::string &second,
+                                                    size_t begin, size_t end)
+{
+    PolylineE5 firstPoints;
+    const bool firstValid = static_cast<bool>(referenceDecode(first.data(), first.size(), firstPoints));
+    PolylineE5 secondPoints;
+    const bool secondValid = static_cast<bool>(referenceDecode(second.data(), second.size(), secondPoints));
+    const bool valid = firstValid && secondValid;
+
+    PolylineE5 joined = firstPoints;
+    joined.insert(joined.end(), secondPoints.begin(), secondPoints.end());
+    if (!sameEdit(Encoder::concat(first, second), valid, joined)) {
+        return "concat differs";
+    }
+
+    // The slice needs the points up to the end of the range only, they are decoded before any error.
+    const size_t available = firstPoints.size();
+    const size_t last = std::min(end, available);
+    const bool sliceValid = begin < last && (firstValid || end <= available);
+    if (!sameEdit(Encoder::slice(first, begin, end), sliceValid,
+                  sliceValid ? range(firstPoints, begin, last) : PolylineE5())) {
+        return "slice differs";
+    }
+
+    // The range is clamped to the points, the removed points start at its clamped beginning.
+    const size_t spliceBegin = std::min(begin, available);
+    const size_t spliceEnd = spliceBegin + (end > begin ? std::min(end - begin, available - spliceBegin) : 0);
+    PolylineE5 spliced = range(firstPoints, 0, spliceBegin);
+    spliced.insert(spliced.end(), secondPoints.begin(), secondPoints.end());
+    spliced.insert(spliced.end(), firstPoints.begin() + spliceEnd, firstPoints.end());
+    if (!sameEdit(Encoder::splice(first, begin, end, second), valid, spliced)) {
+        return "splice differs";
+    }
+
+    return {};
+}
+
+template<int Digits>
+typename PolylineDifferential<Digits>::PolylineE5
+PolylineDifferential<Digits>::makePoints(std::mt19937 &generator, Kind kind)
+{
+    std::uniform_int_distribution<size_t> sizes(0, 300);
+    const size_t size = sizes(generator);
+    const int64_t maxLatitude = s_maxLatitude;
+    const int64_t maxLongitude = s_maxLongitude;
+    PolylineE5 points;
+
+    switch (kind) {
+    case Kind::RandomWalk:
+    case Kind::Garbage:
+    case Kind::Mutated: {
+        std::uniform_int_distribution<int64_t> latitudes(-s_maxLatitude, s_maxLatitude);
+        std::uniform_int_distribution<int64_t> longitudes(-s_maxLongitude, s_maxLongitude);
+        // Steps of all encoded sizes, from one to seven characters.
+        std::uniform_int_distribution<int> bits(0, 31);
+        int64_t latitude = latitudes(generator);
+        int64_t longitude = longitudes(generator);
+        for (size_t i = 0; i < size; ++i) {
+            const int64_t range = (int64_t(1) << bits(generator)) - 1;
+            std::uniform_int_distribution<int64_t> steps(-range, range);
+            latitude = std::max(-maxLatitude, std::min(maxLatitude, latitude + steps(generator)));
+            longitude = std::max(-maxLongitude, std::min(maxLongitude, longitude + steps(generator)));
+            points.push_back(PointE5{ static_cast<int32_t>(latitude), static_cast<int32_t>(longitude) });
+        }
+        break;
+    }
+    case Kind::EdgeValues: {
+        const int32_t latitudes[] = { 0, 1, -1, int32_t(s_maxLatitude), int32_t(-s_maxLatitude),
+                                      int32_t(s_maxLatitude - 1), int32_t(1 - s_maxLatitude) };
+        const int32_t longitudes[] = { 0, 1, -1, int32_t(s_maxLongitude), int32_t(-s_maxLongitude),
+                                       int32_t(s_maxLongitude - 1), int32_t(1 - s_maxLongitude) };
+        std::uniform_int_distribution<size_t> pick(0, 6);
+        for (size_t i = 0; i < size; ++i) {
+            points.push_back(PointE5{ latitudes[pick(generator)], longitudes[pick(generator)] });
+        }
+        break;
+    }
+    case Kind::Long: {
+        // The random walks are joined with jumps, until they are long enough.
+        while (referenceEncode(points).size() < s_parallelSize) {
+            const auto walk = makePoints(generator, Kind::RandomWalk);
+            points.insert(points.end(), walk.begin(), walk.end());
+        }
+        break;
+    }
+    case Kind::RandomValues:
+    case Kind::Count: {
+        std::uniform_int_distribution<int32_t> values(std::numeric_limits<int32_t>::min(),
+                                                      std::numeric_limits<int32_t>::max());
+        for (size_t i = 0; i < size % 20; ++i) {
+            points.push_back(PointE5{ values(generator), values(generator) });
+        }
+        break;
+    }
+    }
+    return points;
+}
+
+template<int Digits>
+std::string PolylineDifferential<Digits>::makeString(std::mt19937 &generator, Kind kind, const PolylineE5 &points)
+{
+    std::string coords = referenceEncode(points);
+
+    if (kind == Kind::Garbage) {
+        // Mostly valid characters, so that the decoding gets far enough to meet the others.
+        std::uniform_int_distribution<int> characters(0, 255);
+        std::uniform_int_distribution<int> valid(63, 126);
+        std::uniform_int_distribution<int> choice(0, 15);
+        for (auto &c : coords) {
+            c = static_cast<char>(choice(generator) == 0 ? characters(generator) : valid(generator));
+        }
+    } else if ((kind == Kind::Mutated || (kind == Kind::Long && generator() % 2 == 0)) && !coords.empty()) {
+        std::uniform_int_distribution<size_t> positions(0, coords.size() - 1);
+        std::uniform_int_distribution<int> characters(0, 255);
+        std::uniform_int_distribution<int> mutations(1, 4);
+        for (int i = mutations(generator); i > 0; --i) {
+            switch (mutations(generator)) {
+            case 1:
+                coords.resize(positions(generator));
+                break;
+            case 2:
+                coords[positions(generator)] = static_cast<char>(characters(generator));
+                break;
+            case 3:
+                // A continuation chunk, that makes the value longer.
+                coords.insert(positions(generator), 1, '~');
+                break;
+            default:
+                coords.erase(positions(generator), 1);
+                break;
+            }
+            if (coords.empty()) {
+                break;
+            }
+            positions = std::uniform_int_distribution<size_t>(0, coords.size() - 1);
+        }
+    }
+    return coords;
+}
+
+template<int Digits>
+std::string PolylineDifferential<Digits>::check(std::mt19937 &generator, size_t &bytes)
+{
+    std::uniform_int_distribution<int> kinds(0, static_cast<int>(Kind::Long) - 1);
+    std::uniform_int_distribution<int> longs(0, 99);
+    const auto kind = longs(generator) == 0 ? Kind::Long : static_cast<Kind>(kinds(generator));
+
+    const PolylineE5 points = makePoints(generator, kind);
+    std::string error = checkEncode(points);
+    if (!error.empty()) {
+        return error;
+    }
+
+    const std::string coords = makeString(generator, kind, points);
+    bytes += coords.size();
+    error = checkDecode(coords.data(), coords.size());
+    if (!error.empty()) {
+        return error + " for \"" + coords + "\"";
+    }
+
+    // The other polyline to join with is of any kind too, often a valid one.
+    const auto otherKind = static_cast<Kind>(kinds(generator));
+    const std::string other = makeString(generator, otherKind, makePoints(generator, otherKind));
+    std::uniform_int_distribution<size_t> positions(0, points.size() + 2);
+    const size_t begin = positions(generator);
+    const size_t end = positions(generator);
+    error = checkEdit(coords, other, begin, end);
+    if (!error.empty()) {
+        std::ostringstream message;
+        message << error << " for \"" << coords << "\", \"" << other << "\", [" << begin << ", " << end << ")";
+        return message.str();
+    }
+    return {};
+}
+
+template<int Digits>
+ThreadPool &PolylineDifferential<Digits>::threadPool()
+{
+    static ThreadPool pool(2);
+    return pool;
+}
+
+template<int Digits>
+std::string PolylineDifferential<Digits>::mismatch(const char *path, const Result &result, const Result &expected)
+{
+    std::ostringstream message;
+    message << path << " returned status " << static_cast<int>(result.status) << " at " << result.position
+            << " after " << result.pointCount << " points, expected status " << static_cast<int>(expected.status)
+            << " at " << expected.position << " after " << expected.pointCount << " points, or the points differ";
+    return message.str();
+}
+
+template<int Digits>
+bool PolylineDifferential<Digits>::same(const Result &first, const Result &second)
+{
+    return first.status == second.status && first.position == second.position &&
+           first.pointCount == second.pointCount;
+}
+
+template<int Digits>
+bool PolylineDifferential<Digits>::same(const PolylineE5 &points, const PolylineE5 &expected)
+{
+    if (points.size() != expected.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (points[i].latitude != expected[i].latitude || points[i].longitude != expected[i].longitude) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<int Digits>
+bool PolylineDifferential<Digits>::same(const Polyline &points, const PolylineE5 &expected)
+{
+    if (points.size() != expected.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (points[i].latitude() != Encoder::fromE5(expected[i].latitude) ||
+            points[i].longitude() != Encoder::fromE5(expected[i].longitude)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<int Digits>
+void PolylineDifferential<Digits>::referenceSimplify(const PolylineE5 &points, size_t first, size_t last,
+                                                     double tolerance, std::vector<bool> &keep)
+{
+    size_t farthest = 0;
+    double maxDistance = tolerance;
+    for (size_t i = first + 1; i < last; ++i) {
+        // The squared distance to the segment, computed as the library does to
+        // round the same way.
+        const double dx = static_cast<double>(points[last].longitude) - points[first].longitude;
+        const double dy = static_cast<double>(points[last].latitude) - points[first].latitude;
+        double px = static_cast<double>(points[i].longitude) - points[first].longitude;
+        double py = static_cast<double>(points[i].latitude) - points[first].latitude;
+        const double length = dx * dx + dy * dy;
+        if (length > 0.0) {
+            const double t = std::max(0.0, std::min(1.0, (px * dx + py * dy) / length));
+            px -= t * dx;
+            py -= t * dy;
+        }
+        const double distance = px * px + py * py;
+        if (distance > maxDistance) {
+            maxDistance = distance;
+            farthest = i;
+        }
+    }
+    if (farthest != 0) {
+        keep[farthest] = true;
+        referenceSimplify(points, first, farthest, tolerance, keep);
+        referenceSimplify(points, farthest, last, tolerance, keep);
+    }
+}
+
+template<int Digits>
+bool PolylineDifferential<Digits>::sameEdit(const std::string &result, bool valid, const PolylineE5 &expected)
+{
+    if (!valid) {
+        return result.empty();
+    }
+    PolylineE5 points;
+    return referenceDecode(result.data(), result.size(), points) && same(points, expected);
+}
+
+template<int Digits>
+typename PolylineDifferential<Digits>::PolylineE5
+PolylineDifferential<Digits>::range(const PolylineE5 &points, size_t begin, size_t end)
+{
+    return PolylineE5(points.begin() + begin, points.begin() + end);
+}
+
+template<int Digits>
+std::vector<double> PolylineDifferential<Digits>::toValues(const PolylineE5 &points)
+{
+    std::vector<double> values;
+    for (const auto &point : points) {
+        values.push_back(Encoder::fromE5(point.latitude));
+        values.push_back(Encoder::fromE5(point.longitude));
+    }
+    return values;
+}
+
+inline std::string checkDifferential(std::mt19937 &generator, size_t &bytes)
+{
+    std::uniform_int_distribution<int> digits(1, 7);
+    switch (digits(generator)) {
+    case 1: return PolylineDifferential<1>::check(generator, bytes);
+    case 2: return PolylineDifferential<2>::check(generator, bytes);
+    case 3: return PolylineDifferential<3>::check(generator, bytes);
+    case 4: return PolylineDifferential<4>::check(generator, bytes);
+    case 5: return PolylineDifferential<5>::check(generator, bytes);
+    case 6: return PolylineDifferential<6>::check(generator, bytes);
+    default: return PolylineDifferential<7>::check(generator, bytes);
+    }
+}
+
+} // namespace gepaf
+
+#endif // POLYLINEDIFFERENTIAL_H
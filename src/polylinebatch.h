@@ -0,0 +1,549 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2017 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef POLYLINEBATCH_H
+#define POLYLINEBATCH_H
+
+#include "polylineencoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gepaf
+{
+
+//! A pool of worker threads that process ranges of items in parallel.
+/*!
+    The range of items is split into small blocks that all threads, including
+    the calling one, take one after another. Threads that got cheap items just
+    take more blocks, so the load stays balanced even if the item costs vary a lot.
+*/
+class ThreadPool
+{
+public:
+    //! Creates a pool of \p threadCount threads, including the calling one.
+    /*!
+        \param threadCount The number of threads. If zero, the number of hardware threads is used.
+    */
+    explicit ThreadPool(size_t threadCount = 0);
+
+    //! Stops and joins all worker threads.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    //! Returns the number of threads, including the calling one.
+    size_t threadCount() const;
+
+    //! Calls the \p function for the blocks [begin, end) of the range [0, count) in parallel.
+    /*!
+        Returns when all items are processed. The function must not throw.
+        Concurrent calls are serialized.
+    */
+    void parallelFor(size_t count, const std::function<void(size_t, size_t)> &function);
+
+private:
+    //! The worker thread loop.
+    void run();
+
+    //! Takes the blocks of the current job until there are none left.
+    void process();
+
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_callMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::condition_variable m_done;
+
+    //! The current job.
+    const std::function<void(size_t, size_t)> *m_function{ nullptr };
+    size_t m_count{ 0 };
+    size_t m_blockSize{ 1 };
+    std::atomic<size_t> m_next{ 0 };
+
+    size_t m_generation{ 0 };
+    size_t m_busyWorkers{ 0 };
+    bool m_stop{ false };
+
+    //! The number of blocks per thread, the more the better balanced is the load.
+    static constexpr const size_t s_blocksPerThread = 16;
+};
+
+//! Encodes and decodes many independent polylines in parallel.
+/*!
+    The results are stored contiguously in a single arena with the table of
+    offsets, in the same order as the input regardless of the number of threads.
+*/
+template<int Digits = 5>
+class PolylineBatch
+{
+public:
+    using Encoder  = PolylineEncoder<Digits>;
+    using Point    = typename Encoder::Point;
+    using Polyline = typename Encoder::Polyline;
+
+    //! Encoded polylines stored one after another.
+    struct Encoded
+    {
+        //! All encoded polylines.
+        std::string data;
+
+        //! The i-th polyline occupies the [offsets[i], offsets[i + 1]) range of the data.
+        std::vector<size_t> offsets;
+
+        //! Returns the number of polylines.
+        size_t size() const;
+
+        //! Returns the i-th encoded polyline.
+        std::string at(size_t i) const;
+
+        //! Returns the view of the i-th encoded polyline.
+        PolylineView<Digits> view(size_t i) const;
+    };
+
+    //! Decoded polylines stored one after another.
+    struct Decoded
+    {
+        //! All points of all polylines.
+        std::vector<Point> points;
+
+        //! The i-th polyline occupies the [offsets[i], offsets[i + 1]) range of the points.
+        std::vector<size_t> offsets;
+
+        //! Returns the number of polylines.
+        size_t size() const;
+
+        //! Returns the i-th polyline.
+        Polyline at(size_t i) const;
+
+        //! Returns the range of the points of the i-th polyline.
+        const Point *begin(size_t i) const;
+        const Point *end(size_t i) const;
+    };
+
+    //! Encodes the polylines of the range [first, last).
+    /*!
+        The sizes of the encoded polylines are computed first, so that each
+        polyline is encoded directly into its place in the arena.
+        \param first The first polyline (Polyline) in the range.
+        \param last  The end of the range.
+        \param pool  The threads to use.
+    */
+    template<typename RandomIt>
+    static Encoded encode(RandomIt first, RandomIt last, ThreadPool &pool);
+
+    //! Decodes the encoded polylines of the range [first, last).
+    /*!
+        Each element of the range must provide data() and size(), like std::string.
+        Invalid polylines are decoded as empty ones, like with PolylineEncoder::decode().
+    */
+    template<typename RandomIt>
+    static Decoded decode(RandomIt first, RandomIt last, ThreadPool &pool);
+
+    //! Decodes a single, very long polyline in parallel.
+    /*!
+        The string is split into chunks at the point boundaries, that are easily
+        found by the characters without the continuation bit. The chunks are
+        decoded concurrently into points relative to the chunk start, then the
+        chunks are shifted by the prefix sums of their offsets.
+        The result is the same as of PolylineEncoder::decode().
+    */
+    static Polyline decodeParallel(const std::string &coords, ThreadPool &pool);
+
+private:
+    //! The polylines shorter than that are decoded in the calling thread.
+    static constexpr const size_t s_minParallelSize = 1 << 16;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ThreadPool implementation
+///////////////////////////////////////////////////////////////////////////////
+inline ThreadPool::ThreadPool(size_t threadCount)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 1; i < threadCount; ++i) {
+        m_workers.emplace_back(&ThreadPool::run, this);
+    }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+inline size_t ThreadPool::threadCount() const
+{
+    return m_workers.size() + 1;
+}
+
+inline void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, size_t)> &function)
+{
+    if (count == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> call(m_callMutex);
+
+    if (m_workers.empty() || count == 1) {
+        function(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_function = &function;
+        m_count = count;
+        m_blockSize = std::max<size_t>(1, count / (threadCount() * s_blocksPerThread));
+        m_next = 0;
+        m_busyWorkers = m_workers.size();
+        ++m_generation;
+    }
+    m_wakeUp.notify_all();
+
+    process();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_function = nullptr;
+}
+
+inline void ThreadPool::run()
+{
+    size_t generation = 0;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wakeUp.wait(lock, [this, generation] { return m_stop || m_generation != generation; });
+        if (m_stop) {
+            return;
+        }
+        generation = m_generation;
+
+        lock.unlock();
+        process();
+        lock.lock();
+
+        if (--m_busyWorkers == 0) {
+            m_done.notify_one();
+        }
+    }
+}
+
+inline void ThreadPool::process()
+{
+    for (;;) {
+        const size_t begin = m_next.fetch_add(m_blockSize);
+        if (begin >= m_count) {
+            break;
+        }
+        (*m_function)(begin, std::min(begin + m_blockSize, m_count));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PolylineBatch implementation
+///////////////////////////////////////////////////////////////////////////////
+template<int Digits>
+size_t PolylineBatch<Digits>::Encoded::size() const
+{
+    return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+template<int Digits>
+std::string PolylineBatch<Digits>::Encoded::at(size_t i) const
+{
+    return data.substr(offsets[i], offsets[i + 1] - offsets[i]);
+}
+
+template<int Digits>
+PolylineView<Digits> PolylineBatch<Digits>::Encoded::view(size_t i) const
+{
+    return PolylineView<Digits>(data.data() + offsets[i], offsets[i + 1] - offsets[i]);
+}
+
+template<int Digits>
+size_t PolylineBatch<Digits>::Decoded::size() const
+{
+    return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+template<int Digits>
+typename PolylineBatch<Digits>::Polyline PolylineBatch<Digits>::Decoded::at(size_t i) const
+{
+    return Polyline(begin(i), end(i));
+}
+
+template<int Digits>
+const typename PolylineBatch<Digits>::Point *PolylineBatch<Digits>::Decoded::begin(size_t i) const
+{
+    return points.data() + offsets[i];
+}
+
+template<int Digits>
+const typename PolylineBatch<Digits>::Point *PolylineBatch<Digits>::Decoded::end(size_t i) const
+{
+    return points.data() + offsets[i + 1];
+}
+
+template<int Digits>
+template<typename RandomIt>
+typename PolylineBatch<Digits>::Encoded PolylineBatch<Digits>::encode(RandomIt first, RandomIt last,
+                                                                      ThreadPool &pool)
+{
+    const auto count = static_cast<size_t>(std::distance(first, last));
+
+    Encoded result;
+    result.offsets.assign(count + 1, 0);
+
+    // The exact sizes of the encoded polylines.
+    pool.parallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            result.offsets[i + 1] = Encoder::encodedSize(first[i]);
+        }
+    });
+
+    for (size_t i = 0; i < count; ++i) {
+        result.offsets[i + 1] += result.offsets[i];
+    }
+
+    if (result.offsets.back() == 0) {
+        return result;
+    }
+
+    // Each polyline is encoded exactly into its own place.
+    result.data.resize(result.offsets.back());
+    char *data = &result.data[0];
+    pool.parallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Encoder::encode(first[i], data + result.offsets[i]);
+        }
+    });
+
+    return result;
+}
+
+template<int Digits>
+template<typename RandomIt>
+typename PolylineBatch<Digits>::Decoded PolylineBatch<Digits>::decode(RandomIt first, RandomIt last,
+                                                                      ThreadPool &pool)
+{
+    const auto count = static_cast<size_t>(std::distance(first, last));
+
+    Decoded result;
+    result.offsets.assign(count + 1, 0);
+
+    // The number of points of valid polylines, that is the upper bound for any input.
+    pool.parallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            result.offsets[i + 1] = PolylineView<Digits>(first[i].data(), first[i].size()).count();
+        }
+    });
+
+    for (size_t i = 0; i < count; ++i) {
+        result.offsets[i + 1] += result.offsets[i];
+    }
+
+    result.points.assign(result.offsets.back(), Point::fromE5(0, 0));
+
+    // Decode into the reserved places and remember the actual number of points.
+    std::vector<size_t> sizes(count, 0);
+    Point *points = result.points.data();
+    pool.parallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Point *out = points + result.offsets[i];
+            Point *const outEnd = points + result.offsets[i + 1];
+            const char *data = first[i].data();
+
+            const auto status = Encoder::decodePoints(data, data + first[i].size(), [&](int32_t lat, int32_t lon) {
+                if (out != outEnd) {
+                    *out++ = Point::fromE5(lat, lon);
+                }
+            });
+            sizes[i] = status ? static_cast<size_t>(out - (points + result.offsets[i])) : 0;
+        }
+    });
+
+    // Remove the gaps left by invalid polylines, if any.
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const size_t offset = result.offsets[i];
+        if (total != offset) {
+            std::copy(points + offset, points + offset + sizes[i], points + total);
+        }
+        result.offsets[i] = total;
+        total += sizes[i];
+    }
+    result.offsets[count] = total;
+    result.points.resize(total, Point::fromE5(0, 0));
+
+    return result;
+}
+
+template<int Digits>
+typename PolylineBatch<Digits>::Polyline PolylineBatch<Digits>::decodeParallel(const std::string &coords,
+                                                                               ThreadPool &pool)
+{
+    const size_t size = coords.size();
+    if (size < s_minParallelSize || pool.threadCount() == 1) {
+        return Encoder::decode(coords);
+    }
+
+    const char *data = coords.data();
+    const auto isLastChunk = [data](size_t i) {
+        return static_cast<unsigned char>(data[i]) - Encoder::s_asciiOffset < Encoder::s_6bitMask;
+    };
+
+    // Count the values in the evenly split chunks.
+    const size_t chunkCount = pool.threadCount() * 4;
+    std::vector<size_t> starts(chunkCount + 1);
+    std::vector<size_t> values(chunkCount + 1, 0);
+    for (size_t c = 0; c <= chunkCount; ++c) {
+        starts[c] = size / chunkCount * c;
+    }
+    starts[chunkCount] = size;
+
+    pool.parallelFor(chunkCount, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            for (size_t i = starts[c]; i < starts[c + 1]; ++i) {
+                values[c + 1] += isLastChunk(i);
+            }
+        }
+    });
+    for (size_t c = 0; c < chunkCount; ++c) {
+        values[c + 1] += values[c];
+    }
+    if (values[chunkCount] % 2 != 0) {
+        // Incomplete point, implies invalid polyline string.
+        return Polyline();
+    }
+
+    // Move the chunk starts forward to the nearest point boundaries: after an even number of values.
+    for (size_t c = 1; c < chunkCount; ++c) {
+        size_t i = std::max(starts[c], starts[c - 1]);
+        size_t valueCount = values[c];
+        if (i > starts[c]) {
+            valueCount = values[c - 1];
+            for (size_t j = starts[c - 1]; j < i; ++j) {
+                valueCount += isLastChunk(j);
+            }
+        }
+        while (i < size && ((i > 0 && !isLastChunk(i - 1)) || valueCount % 2 != 0)) {
+            valueCount += isLastChunk(i++);
+        }
+        starts[c] = i;
+        values[c] = valueCount;
+    }
+
+    // Decode the chunks into the points relative to the chunk starts.
+    using PointE5 = typename Encoder::PointE5;
+    std::vector<PointE5> relative(values[chunkCount] / 2);
+    std::vector<PointE5> chunkOffsets(chunkCount + 1, PointE5{ 0, 0 });
+    std::atomic<bool> valid{ true };
+
+    pool.parallelFor(chunkCount, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            const size_t first = values[c] / 2;
+            const size_t last = values[c + 1] / 2;
+            size_t i = first;
+
+            // The coordinates are relative to the chunk start and are checked at the end.
+            const char *it = data + starts[c];
+            const char *const chunkEnd = data + starts[c + 1];
+            uint32_t lat = 0;
+            uint32_t lon = 0;
+            bool decoded = true;
+            while (decoded && it != chunkEnd) {
+                int32_t latDelta = 0;
+                int32_t lonDelta = 0;
+                decoded = Encoder::decodePoint(it, chunkEnd, latDelta, lonDelta) == Encoder::Status::Ok;
+                lat += static_cast<uint32_t>(latDelta);
+                lon += static_cast<uint32_t>(lonDelta);
+                if (decoded && i < last) {
+                    relative[i] = PointE5{ static_cast<int32_t>(lat), static_cast<int32_t>(lon) };
+                }
+                ++i;
+            }
+            if (!decoded || i != last) {
+                valid = false;
+            } else if (last > first) {
+                chunkOffsets[c + 1] = relative[last - 1];
+            }
+        }
+    });
+
+    if (!valid) {
+        return Polyline();
+    }
+
+    // The absolute position of each chunk start, in modular arithmetic.
+    for (size_t c = 0; c < chunkCount; ++c) {
+        chunkOffsets[c + 1].latitude = static_cast<int32_t>(static_cast<uint32_t>(chunkOffsets[c + 1].latitude) +
+                                                            static_cast<uint32_t>(chunkOffsets[c].latitude));
+        chunkOffsets[c + 1].longitude = static_cast<int32_t>(static_cast<uint32_t>(chunkOffsets[c + 1].longitude) +
+                                                             static_cast<uint32_t>(chunkOffsets[c].longitude));
+    }
+
+    Polyline polyline(relative.size(), Point::fromE5(0, 0));
+    pool.parallelFor(chunkCount, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            const auto lat = static_cast<uint32_t>(chunkOffsets[c].latitude);
+            const auto lon = static_cast<uint32_t>(chunkOffsets[c].longitude);
+            for (size_t i = values[c] / 2; i < values[c + 1] / 2; ++i) {
+                const uint32_t latitude = lat + static_cast<uint32_t>(relative[i].latitude);
+                const uint32_t longitude = lon + static_cast<uint32_t>(relative[i].longitude);
+                if (!Encoder::isValid(latitude, longitude)) {
+                    valid = false;
+                }
+                polyline[i] = Point::fromE5(static_cast<int32_t>(latitude), static_cast<int32_t>(longitude));
+            }
+        }
+    });
+
+    if (!valid) {
+        return Polyline();
+    }
+    return polyline;
+}
+
+} // namespace
+
+#endif // POLYLINEBATCH_H
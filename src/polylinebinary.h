@@ -0,0 +1,426 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2017 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef POLYLINEBINARY_H
+#define POLYLINEBINARY_H
+
+#include "polylineencoder.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gepaf
+{
+
+//! Stores polylines in a compact binary format and transcodes them to and from encoded polylines.
+/*!
+    The binary polyline starts with a byte of the Mode, followed by the offsets
+    of the fixed-point coordinates, zigzag encoded as in the polyline algorithm,
+    but stored as LEB128 varints: 7 bits of payload per byte instead of 5 bits
+    per character.
+
+    Regularly sampled tracks, e.g. of GPS receivers, have offsets that change
+    slowly, so in the Mode::DeltaOfDelta mode the difference of each offset from
+    the previous one is stored instead, which mostly fits into a single byte.
+
+    The same points are stored in both formats, so transcoding is lossless and
+    the encoded polyline is the same as the one of the PolylineEncoder.
+*/
+template<int Digits = 5>
+class PolylineBinary
+{
+public:
+    using Encoder = PolylineEncoder<Digits>;
+    using PointE5 = typename Encoder::PointE5;
+    using PolylineE5 = typename Encoder::PolylineE5;
+    using Status = typename Encoder::Status;
+    using Result = typename Encoder::Result;
+
+    //! The way the points are stored, the first byte of the binary polyline.
+    enum class Mode : unsigned char
+    {
+        Delta = 0,       ///< The offsets from the previous points.
+        DeltaOfDelta = 1 ///< The differences of the offsets from the previous offsets.
+    };
+
+    //! Returns the binary polyline of the given fixed-point \p polyline.
+    static std::string encodeE5(const PolylineE5 &polyline, Mode mode = Mode::Delta);
+
+    //! Appends the binary polyline of the \p count fixed-point \p points to the \p result string.
+    static void encodeE5(const PointE5 *points, size_t count, Mode mode, std::string &result);
+
+    //! Returns the fixed-point polyline decoded from the given \p binary polyline.
+    /*!
+        Invalid binary polylines result in an empty polyline.
+    */
+    static PolylineE5 decodeE5(const std::string &binary);
+
+    //! Appends the fixed-point points decoded from the \p size bytes of \p data to the \p polyline.
+    /*!
+        The decoding stops at the first error, but the points decoded so far are kept.
+        An unknown mode is reported as InvalidCharacter at the position 0.
+        \returns The status and the position of the first error.
+    */
+    static Result decodeE5(const char *data, size_t size, PolylineE5 &polyline);
+
+    //! Returns the binary polyline of the given encoded polyline \p coordinates.
+    /*!
+        Invalid encoded polylines result in an empty string.
+    */
+    static std::string fromPolyline(const std::string &coordinates, Mode mode = Mode::Delta);
+
+    //! Appends the binary polyline of the encoded polyline given by the \p size characters of \p data
+    //! to the \p binary string.
+    /*!
+        No points are created, the offsets are transcoded in batches. The transcoding
+        stops at the first error, the points before it are kept.
+        \returns The status and the position of the first error in the encoded polyline.
+    */
+    static Result fromPolyline(const char *data, size_t size, Mode mode, std::string &binary);
+
+    //! Returns the encoded polyline of the given \p binary polyline.
+    /*!
+        Invalid binary polylines result in an empty string.
+    */
+    static std::string toPolyline(const std::string &binary);
+
+    //! Appends the encoded polyline of the binary polyline given by the \p size bytes of \p data
+    //! to the \p coordinates string.
+    /*!
+        The transcoding stops at the first error, the points before it are kept.
+        \returns The status and the position of the first error in the binary polyline.
+    */
+    static Result toPolyline(const char *data, size_t size, std::string &coordinates);
+
+private:
+    //! The state of the encoding or the decoding of the binary points.
+    struct State
+    {
+        Mode mode;
+        uint32_t previous[2];
+        uint32_t delta[2];
+        bool first;
+    };
+
+    //! Returns the initial state for the given \p mode.
+    static State start(Mode mode);
+
+    //! Returns the value stored for the \p value and updates the state of the coordinate \p index.
+    static uint32_t encodeValue(State &state, int index, uint32_t value);
+
+    //! Returns the value that is stored as \p stored and updates the state of the coordinate \p index.
+    static uint32_t decodeValue(State &state, int index, uint32_t stored);
+
+    //! Encodes a batch of \p count points, the buffer must have at least bufferSize(count) bytes.
+    /*!
+        \returns The pointer past the last encoded byte.
+    */
+    static char *encodeBatch(const PointE5 *points, size_t count, State &state, char *out);
+
+    //! Writes the LEB128 varint of the \p value.
+    static char *encodeVarint(uint32_t value, char *out);
+
+    //! Reads the LEB128 varint and advances the \p it.
+    /*!
+        On failure the \p it points to the offending byte or, if the value is
+        incomplete, to its first byte.
+    */
+    static Status decodeVarint(const char *&it, const char *end, uint32_t &value);
+
+    //! Decodes all points of the binary polyline and passes them to the \p emit function.
+    template<typename Emit>
+    static Result decodePoints(const char *data, size_t size, Emit &&emit);
+
+    //! Returns the size of the buffer for \p pointCount points.
+    static size_t bufferSize(size_t pointCount);
+
+    //! The longest varint of 32 bits.
+    static constexpr const int s_maxVarintSize = 5;
+
+    //! The number of points transcoded at once.
+    static constexpr const int s_batchSize = 64;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PolylineBinary implementation
+///////////////////////////////////////////////////////////////////////////////
+template<int Digits>
+std::string PolylineBinary<Digits>::encodeE5(const PolylineE5 &polyline, Mode mode)
+{
+    std::string result;
+    encodeE5(polyline.data(), polyline.size(), mode, result);
+    return result;
+}
+
+template<int Digits>
+void PolylineBinary<Digits>::encodeE5(const PointE5 *points, size_t count, Mode mode, std::string &result)
+{
+    const auto offset = result.size();
+    result.resize(offset + 1 + bufferSize(count));
+
+    char *begin = &result[0];
+    char *out = begin + offset;
+    *out++ = static_cast<char>(mode);
+
+    auto state = start(mode);
+    out = encodeBatch(points, count, state, out);
+    result.resize(out - begin);
+}
+
+template<int Digits>
+typename PolylineBinary<Digits>::PolylineE5 PolylineBinary<Digits>::decodeE5(const std::string &binary)
+{
+    PolylineE5 polyline;
+    if (!decodeE5(binary.data(), binary.size(), polyline)) {
+        polyline.clear();
+    }
+    return polyline;
+}
+
+template<int Digits>
+typename PolylineBinary<Digits>::Result PolylineBinary<Digits>::decodeE5(const char *data, size_t size,
+                                                                         PolylineE5 &polyline)
+{
+    return decodePoints(data, size, [&polyline](const PointE5 &point) {
+        polyline.push_back(point);
+    });
+}
+
+template<int Digits>
+std::string PolylineBinary<Digits>::fromPolyline(const std::string &coords, Mode mode)
+{
+    std::string binary;
+    if (!fromPolyline(coords.data(), coords.size(), mode, binary)) {
+        binary.clear();
+    }
+    return binary;
+}
+
+template<int Digits>
+typename PolylineBinary<Digits>::Result PolylineBinary<Digits>::fromPolyline(const char *data, size_t size,
+                                                                             Mode mode, std::string &binary)
+{
+    binary.push_back(static_cast<char>(mode));
+
+    auto state = start(mode);
+    PointE5 batch[s_batchSize];
+    size_t count = 0;
+
+    const auto flush = [&]() {
+        const auto offset = binary.size();
+        binary.resize(offset + bufferSize(count));
+        char *begin = &binary[0];
+        binary.resize(encodeBatch(batch, count, state, begin + offset) - begin);
+        count = 0;
+    };
+
+    const auto result = Encoder::decodePoints(data, data + size, [&](int32_t lat, int32_t lon) {
+        batch[count++] = PointE5{ lat, lon };
+        if (count == s_batchSize) {
+            flush();
+        }
+    });
+    flush();
+
+    return result;
+}
+
+template<int Digits>
+std::string PolylineBinary<Digits>::toPolyline(const std::string &binary)
+{
+    std::string coords;
+    if (!toPolyline(binary.data(), binary.size(), coords)) {
+        coords.clear();
+    }
+    return coords;
+}
+
+template<int Digits>
+typename PolylineBinary<Digits>::Result PolylineBinary<Digits>::toPolyline(const char *data, size_t size,
+                                                                           std::string &coords)
+{
+    PointE5 previous{ 0, 0 };
+    PointE5 batch[s_batchSize];
+    size_t count = 0;
+
+    const auto flush = [&]() {
+        const auto offset = coords.size();
+        coords.resize(offset + Encoder::bufferSize(count));
+        char *begin = &coords[0];
+        coords.resize(Encoder::encodeBatch(batch, count, previous, begin + offset) - begin);
+        count = 0;
+    };
+
+    const auto result = decodePoints(data, size, [&](const PointE5 &point) {
+        batch[count++] = point;
+        if (count == s_batchSize) {
+            flush();
+        }
+    });
+    flush();
+
+    return result;
+}
+
+template<int Digits>
+typename PolylineBinary<Digits>::State PolylineBinary<Digits>::start(Mode mode)
+{
+    return State{ mode, { 0, 0 }, { 0, 0 }, true };
+}
+
+template<int Digits>
+uint32_t PolylineBinary<Digits>::encodeValue(State &state, int index, uint32_t value)
+{
+    // The offsets are computed in modular arithmetic, as of the PolylineEncoder.
+    const uint32_t delta = value - state.previous[index];
+    const uint32_t stored = delta - state.delta[index];
+
+    state.previous[index] = value;
+    // The first point is stored as is, the offset of the second one is not a difference.
+    if (state.mode == Mode::DeltaOfDelta && !state.first) {
+        state.delta[index] = delta;
+    }
+    return stored;
+}
+
+template<int Digits>
+uint32_t PolylineBinary<Digits>::decodeValue(State &state, int index, uint32_t stored)
+{
+    const uint32_t delta = stored + state.delta[index];
+    const uint32_t value = state.previous[index] + delta;
+
+    state.previous[index] = value;
+    if (state.mode == Mode::DeltaOfDelta && !state.first) {
+        state.delta[index] = delta;
+    }
+    return value;
+}
+
+template<int Digits>
+char *PolylineBinary<Digits>::encodeBatch(const PointE5 *points, size_t count, State &state, char *out)
+{
+    for (size_t i = 0; i < count; ++i) {
+        const auto lat = encodeValue(state, 0, static_cast<uint32_t>(points[i].latitude));
+        const auto lon = encodeValue(state, 1, static_cast<uint32_t>(points[i].longitude));
+        state.first = false;
+
+        out = encodeVarint(Encoder::zigzag(static_cast<int32_t>(lat)), out);
+        out = encodeVarint(Encoder::zigzag(static_cast<int32_t>(lon)), out);
+    }
+    return out;
+}
+
+template<int Digits>
+char *PolylineBinary<Digits>::encodeVarint(uint32_t value, char *out)
+{
+    while (value >= 0x80) {
+        *out++ = static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<char>(value);
+    return out;
+}
+
+template<int Digits>
+typename PolylineBinary<Digits>::Status PolylineBinary<Digits>::decodeVarint(const char *&it, const char *end,
+                                                                             uint32_t &value)
+{
+    const char *start = it;
+    value = 0;
+
+    for (int shift = 0; it != end; shift += 7) {
+        const auto byte = static_cast<uint32_t>(static_cast<unsigned char>(*it));
+        if (shift == 28 && byte > 0x0f) {
+            // The fifth byte has only 4 bits left and no continuation.
+            return Status::Overflow;
+        }
+        value |= (byte & 0x7f) << shift;
+        ++it;
+        if ((byte & 0x80) == 0) {
+            return Status::Ok;
+        }
+    }
+
+    it = start;
+    return Status::Incomplete;
+}
+
+template<int Digits>
+template<typename Emit>
+typename PolylineBinary<Digits>::Result PolylineBinary<Digits>::decodePoints(const char *data, size_t size,
+                                                                             Emit &&emit)
+{
+    if (size == 0) {
+        return Result{ Status::Incomplete, 0, 0 };
+    }
+
+    const auto mode = static_cast<Mode>(static_cast<unsigned char>(data[0]));
+    if (mode != Mode::Delta && mode != Mode::DeltaOfDelta) {
+        return Result{ Status::InvalidCharacter, 0, 0 };
+    }
+
+    auto state = start(mode);
+    const char *it = data + 1;
+    const char *end = data + size;
+    size_t count = 0;
+
+    while (it != end) {
+        const char *point = it;
+        uint32_t lat = 0;
+        uint32_t lon = 0;
+
+        auto status = decodeVarint(it, end, lat);
+        if (status == Status::Ok) {
+            status = decodeVarint(it, end, lon);
+        }
+        if (status != Status::Ok) {
+            return Result{ status, static_cast<size_t>(it - data), count };
+        }
+
+        const auto unzigzag = [](uint32_t value) { return (value >> 1) ^ (0u - (value & 1)); };
+        lat = decodeValue(state, 0, unzigzag(lat));
+        lon = decodeValue(state, 1, unzigzag(lon));
+        state.first = false;
+
+        if (!Encoder::isValid(lat, lon)) {
+            return Result{ Status::OutOfRange, static_cast<size_t>(point - data), count };
+        }
+
+        emit(PointE5{ static_cast<int32_t>(lat), static_cast<int32_t>(lon) });
+        ++count;
+    }
+
+    return Result{ Status::Ok, size, count };
+}
+
+template<int Digits>
+size_t PolylineBinary<Digits>::bufferSize(size_t pointCount)
+{
+    return pointCount * 2 * s_maxVarintSize;
+}
+
+} // namespace
+
+#endif // POLYLINEBINARY_H
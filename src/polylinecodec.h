@@ -0,0 +1,275 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2017 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef POLYLINECODEC_H
+#define POLYLINECODEC_H
+
+#include "polylineencoder.h"
+
+#include <cassert>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace gepaf
+{
+
+//! Encodes and decodes polylines with the precision given at run time and optional extra dimensions.
+/*!
+    The points may have a third and a fourth value, e.g. an elevation and a
+    timestamp, each with its own precision. All values of a point are encoded
+    as offsets from the previous point one after another, in the same way as
+    latitudes and longitudes are, so two-dimensional polylines are identical
+    to the ones of PolylineEncoder with the same precision. The encoded string
+    does not describe itself: the decoder must be created with the same
+    parameters as the encoder.
+
+    The points are stored as flat arrays of interleaved values, e.g. latitude,
+    longitude, elevation, latitude, longitude, elevation, etc.
+    Two-dimensional polylines with 5, 6 and 7 digits precision are processed
+    by the PolylineEncoder specializations.
+*/
+class PolylineCodec
+{
+public:
+    //! Creates a codec.
+    /*!
+        \param precision       The number of decimal places of the latitudes and longitudes, 0 to 7.
+        \param dimensions      The number of values per point, 2 to 4.
+        \param thirdPrecision  The number of decimal places of the third values.
+        \param fourthPrecision The number of decimal places of the fourth values.
+        The values of the third and the fourth dimensions multiplied by 10^precision
+        must fit into 32 bits.
+    */
+    explicit PolylineCodec(int precision = 5, int dimensions = 2, int thirdPrecision = 0,
+                           int fourthPrecision = 0);
+
+    //! Returns the number of decimal places of the latitudes and longitudes.
+    int precision() const;
+
+    //! Returns the number of values per point.
+    int dimensions() const;
+
+    //! Returns the result of encoding of the given interleaved \p values.
+    /*!
+        The number of values must be a multiple of the dimensions.
+    */
+    std::string encode(const std::vector<double> &values) const;
+
+    //! Appends the result of encoding of \p count points given by the interleaved \p values
+    //! to the \p result string.
+    void encode(const double *values, size_t count, std::string &result) const;
+
+    //! Returns the interleaved values decoded from the given \p coordinates string.
+    /*!
+        Invalid strings result in no values.
+    */
+    std::vector<double> decode(const std::string &coordinates) const;
+
+    //! Appends the interleaved values decoded from the \p size characters of \p data to the \p values.
+    /*!
+        The decoding stops at the first error, but the values of the points decoded
+        so far are kept.
+        \returns false if the string is invalid.
+    */
+    bool decode(const char *data, size_t size, std::vector<double> &values) const;
+
+private:
+    using Encoder = PolylineEncoder<5>;
+
+    //! Encodes the points with the PolylineEncoder of the given precision.
+    template<int Digits>
+    static void encodePoints(const double *values, size_t count, std::string &result);
+
+    //! Decodes the points with the PolylineEncoder of the given precision.
+    template<int Digits>
+    static bool decodePoints(const char *data, size_t size, std::vector<double> &values);
+
+    //! Encodes the points with any precision and dimensions.
+    void encodeValues(const double *values, size_t count, std::string &result) const;
+
+    //! Decodes the points with any precision and dimensions.
+    bool decodeValues(const char *data, size_t size, std::vector<double> &values) const;
+
+    int m_precision;
+    int m_dimensions;
+
+    //! The multipliers of the values to get the fixed-point values.
+    double m_scales[4];
+
+    //! The bounds of the latitudes and longitudes in the fixed-point representation.
+    int64_t m_maxLatitude;
+    int64_t m_maxLongitude;
+
+    static constexpr const int s_maxDimensions = 4;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PolylineCodec implementation
+///////////////////////////////////////////////////////////////////////////////
+inline PolylineCodec::PolylineCodec(int precision, int dimensions, int thirdPrecision, int fourthPrecision)
+    : m_precision(precision)
+    , m_dimensions(dimensions)
+{
+    assert(precision >= 0 && precision <= 7);
+    assert(dimensions >= 2 && dimensions <= s_maxDimensions);
+
+    const int precisions[s_maxDimensions] = { precision, precision, thirdPrecision, fourthPrecision };
+    for (int i = 0; i < s_maxDimensions; ++i) {
+        // Powers of ten are exact, the same as PolylineEncoder::Precision::Value.
+        m_scales[i] = std::pow(10.0, precisions[i]);
+    }
+    m_maxLatitude = 90LL * static_cast<int64_t>(m_scales[0]);
+    m_maxLongitude = 180LL * static_cast<int64_t>(m_scales[0]);
+}
+
+inline int PolylineCodec::precision() const
+{
+    return m_precision;
+}
+
+inline int PolylineCodec::dimensions() const
+{
+    return m_dimensions;
+}
+
+inline std::string PolylineCodec::encode(const std::vector<double> &values) const
+{
+    std::string result;
+    encode(values.data(), values.size() / m_dimensions, result);
+    return result;
+}
+
+inline void PolylineCodec::encode(const double *values, size_t count, std::string &result) const
+{
+    if (m_dimensions == 2) {
+        switch (m_precision) {
+        case 5: return encodePoints<5>(values, count, result);
+        case 6: return encodePoints<6>(values, count, result);
+        case 7: return encodePoints<7>(values, count, result);
+        }
+    }
+    encodeValues(values, count, result);
+}
+
+inline std::vector<double> PolylineCodec::decode(const std::string &coords) const
+{
+    std::vector<double> values;
+    if (!decode(coords.data(), coords.size(), values)) {
+        values.clear();
+    }
+    return values;
+}
+
+inline bool PolylineCodec::decode(const char *data, size_t size, std::vector<double> &values) const
+{
+    if (m_dimensions == 2) {
+        switch (m_precision) {
+        case 5: return decodePoints<5>(data, size, values);
+        case 6: return decodePoints<6>(data, size, values);
+        case 7: return decodePoints<7>(data, size, values);
+        }
+    }
+    return decodeValues(data, size, values);
+}
+
+template<int Digits>
+void PolylineCodec::encodePoints(const double *values, size_t count, std::string &result)
+{
+    using DigitsEncoder = PolylineEncoder<Digits>;
+    DigitsEncoder::encodeIndexed(count, [values](size_t i) {
+        return typename DigitsEncoder::PointE5{ DigitsEncoder::toE5(values[2 * i]),
+                                                DigitsEncoder::toE5(values[2 * i + 1]) };
+    }, result);
+}
+
+template<int Digits>
+bool PolylineCodec::decodePoints(const char *data, size_t size, std::vector<double> &values)
+{
+    using DigitsEncoder = PolylineEncoder<Digits>;
+    return static_cast<bool>(DigitsEncoder::decodePoints(data, data + size, [&values](int32_t lat, int32_t lon) {
+        values.push_back(DigitsEncoder::fromE5(lat));
+        values.push_back(DigitsEncoder::fromE5(lon));
+    }));
+}
+
+inline void PolylineCodec::encodeValues(const double *values, size_t count, std::string &result) const
+{
+    const size_t valueCount = count * static_cast<size_t>(m_dimensions);
+
+    // The same worst-case buffer as of the PolylineEncoder, with the slack for the word stores.
+    const auto offset = result.size();
+    result.resize(offset + valueCount * Encoder::s_maxChunks + sizeof(uint64_t));
+
+    char *begin = &result[0];
+    char *out = begin + offset;
+
+    uint32_t previous[s_maxDimensions] = {};
+    for (size_t i = 0; i < valueCount; i += m_dimensions) {
+        for (int d = 0; d < m_dimensions; ++d) {
+            const auto value = static_cast<uint32_t>(static_cast<int32_t>(std::round(values[i + d] * m_scales[d]))); // (2)
+            out = Encoder::encodeZigzag(Encoder::zigzag(static_cast<int32_t>(value - previous[d])), out);
+            previous[d] = value;
+        }
+    }
+
+    result.resize(out - begin);
+}
+
+inline bool PolylineCodec::decodeValues(const char *data, size_t size, std::vector<double> &values) const
+{
+    const char *it = data;
+    const char *end = data + size;
+
+    uint32_t current[s_maxDimensions] = {};
+    while (it != end) {
+        uint32_t point[s_maxDimensions] = {};
+        for (int d = 0; d < m_dimensions; ++d) {
+            int32_t delta = 0;
+            if (Encoder::decode(it, end, delta) != Encoder::Status::Ok) {
+                // Invalid or incomplete value, implies invalid polyline string.
+                return false;
+            }
+            point[d] = current[d] + static_cast<uint32_t>(delta);
+        }
+
+        const auto lat = static_cast<int64_t>(static_cast<int32_t>(point[0]));
+        const auto lon = static_cast<int64_t>(static_cast<int32_t>(point[1]));
+        if (lat > m_maxLatitude || lat < -m_maxLatitude || lon > m_maxLongitude || lon < -m_maxLongitude) {
+            // Invalid coordinates, imply invalid polyline string.
+            return false;
+        }
+
+        for (int d = 0; d < m_dimensions; ++d) {
+            current[d] = point[d];
+            values.push_back(static_cast<int32_t>(point[d]) / m_scales[d]);
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+#endif // POLYLINECODEC_H
@@ -25,17 +25,53 @@
 #ifndef POLYLINEENCODER_H
 #define POLYLINEENCODER_H
 
+#include <algorithm>
 #include <cassert>
 #include <cinttypes>
 #include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <functional>
+#include <iterator>
 #include <limits>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#ifdef _MSC_VER
+#   include <intrin.h>
+#endif
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#   define POLYLINEENCODER_CXX17 1
+#   define POLYLINEENCODER_CONSTEXPR constexpr
+#   include <array>
+#   include <string_view>
+#   ifdef __has_include
+#       if __has_include(<memory_resource>)
+#           define POLYLINEENCODER_PMR 1
+#           include <memory_resource>
+#       endif
+#   endif
+#else
+#   define POLYLINEENCODER_CONSTEXPR
+#endif
+
+#ifdef POLYLINEENCODER_ENABLE_STATS
+#   include "polylinestats.h"
+#endif
+
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || \
+    defined(_M_IX86) || defined(_M_X64) || defined(_M_ARM) || defined(_M_ARM64)
+#   define POLYLINEENCODER_LITTLE_ENDIAN 1
+#endif
+
 namespace gepaf
 {
 
+class PolylineCodec;
+
 //! Implements Google's Encoded Polyline Algorithm Format
 /*!
     For more details refer to the algorithm definition at
@@ -49,6 +85,17 @@ template<int Digits = 5>
 class PolylineEncoder
 {
 public:
+    /// A geodetic point in the fixed-point representation.
+    /*!
+        The coordinates are the decimal degrees multiplied by Precision::Value
+        and rounded to integers, e.g. 1e-5 degree units (E5) for 5 digits precision.
+    */
+    struct PointE5
+    {
+        int32_t latitude;
+        int32_t longitude;
+    };
+
     /// A geodetic point.
     class Point
     {
@@ -68,7 +115,15 @@ public:
         /// Returns the longitude.
         double longitude() const;
 
+        /// Creates a geodetic point from the given fixed-point coordinates.
+        /*!
+            No rounding is involved as the coordinates are already of the right precision.
+        */
+        static Point fromE5(int32_t latitude, int32_t longitude);
+
     private:
+        Point() = default;
+
         double m_latitude { 0.0 };
         double m_longitude{ 0.0 };
     };
@@ -76,66 +131,677 @@ public:
     /// The container of geodetic points to be encoded.
     using Polyline = std::vector<Point>;
 
+    /// The container of fixed-point geodetic points.
+    using PolylineE5 = std::vector<PointE5>;
+
+    /// The string with a custom allocator, that the encoded polylines can be appended to.
+    template<typename Allocator>
+    using BasicString = std::basic_string<char, std::char_traits<char>, Allocator>;
+
+#ifdef POLYLINEENCODER_PMR
+    /// The containers that allocate from a std::pmr::memory_resource, e.g. a per-request arena.
+    using PmrPolyline = std::pmr::vector<Point>;
+    using PmrPolylineE5 = std::pmr::vector<PointE5>;
+    using PmrString = std::pmr::string;
+#endif
+
+    /// The polyline stored as separate contiguous columns of coordinates.
+    struct Columns
+    {
+        std::vector<double> latitudes;
+        std::vector<double> longitudes;
+    };
+
+    /// The fixed-point polyline stored as separate contiguous columns of coordinates.
+    struct ColumnsE5
+    {
+        std::vector<int32_t> latitudes;
+        std::vector<int32_t> longitudes;
+    };
+
+    /// The outcome of validation or decoding of an encoded polyline.
+    enum class Status
+    {
+        Ok,               ///< The string is a valid polyline.
+        Incomplete,       ///< The string ends in the middle of a value or a point.
+        InvalidCharacter, ///< A character is out of the ['?', '~'] range (63 - 126).
+        Overflow,         ///< A value does not fit into 32 bits, or the points into a FixedPolyline.
+        OutOfRange        ///< A coordinate exceeds ±90.0° latitude or ±180.0° longitude.
+    };
+
+    /// The result of validation or decoding of an encoded polyline.
+    struct Result
+    {
+        Status status;
+
+        /// The byte offset of the error, or the size of the string if it is valid.
+        /*!
+            The offending character for InvalidCharacter and Overflow, the first
+            character of the truncated value for Incomplete and the first character
+            of the point for OutOfRange.
+        */
+        size_t position;
+
+        /// The number of valid points before the error.
+        size_t pointCount;
+
+        explicit constexpr operator bool() const { return status == Status::Ok; }
+    };
+
+    /// The bounding box of a polyline in the fixed-point representation.
+    struct BoundingBox
+    {
+        PointE5 min;
+        PointE5 max;
+    };
+
+#ifdef POLYLINEENCODER_CXX17
+    /// The encoded polyline of at most Capacity characters, that can be created at compile time.
+    template<size_t Capacity>
+    struct FixedString
+    {
+        /// The null-terminated characters.
+        char data[Capacity + 1]{};
+        size_t size{ 0 };
+
+        constexpr std::string_view view() const { return std::string_view(data, size); }
+        constexpr operator std::string_view() const { return view(); }
+    };
+
+    /// The decoded polyline of at most Capacity points, that can be created at compile time.
+    template<size_t Capacity>
+    struct FixedPolyline
+    {
+        std::array<PointE5, Capacity> points{};
+
+        /// The result of decoding, the number of points is result.pointCount.
+        Result result{ Status::Ok, 0, 0 };
+
+        constexpr size_t size() const { return result.pointCount; }
+        constexpr const PointE5 *begin() const { return points.data(); }
+        constexpr const PointE5 *end() const { return points.data() + size(); }
+        constexpr const PointE5 &operator[](size_t index) const { return points[index]; }
+
+        /// Returns the latitude of the point at \p index in decimal degrees.
+        constexpr double latitude(size_t index) const { return fromE5(points[index].latitude); }
+
+        /// Returns the longitude of the point at \p index in decimal degrees.
+        constexpr double longitude(size_t index) const { return fromE5(points[index].longitude); }
+    };
+#endif
+
+    //! Creates an encoder that keeps the added points.
+    PolylineEncoder() = default;
+
+    //! Creates an encoder that keeps the added points only if \p keepPoints is true.
+    /*!
+        The points are encoded as they are added, so only the encoded string
+        has to be kept to encode a live, ever-growing track.
+    */
+    explicit PolylineEncoder(bool keepPoints);
+
     //! Adds new point with the given \p latitude and \p longitude for encoding.
     /*!
         Note: both latitude and longitude will be rounded to a reasonable precision
         of 5 decimal places (default) or to the number of digits specified by the
         template parameter.
+        Only the offset from the previous point is encoded and appended to the
+        encoded polyline.
         \param latitude  The latitude in decimal point degrees. The values are bounded by ±90.0°.
         \param longitude The longitude in decimal point degrees. The values are bounded by ±180.0°.
     */
     void addPoint(double latitude, double longitude);
 
+    //! Adds new point with the given fixed-point coordinates for encoding.
+    void addPointE5(int32_t latitude, int32_t longitude);
+
     //! Encode the polyline according to the defined compression algorithm.
     /*!
     \return The encoded polyline as string.
     */
     std::string encode() const;
 
-    //! Returns the existing polyline.
+    //! Returns the encoded polyline of all points added so far, without copying it.
+    const std::string &encoded() const;
+
+    //! Returns the existing polyline, which is empty if the points are not kept.
     const Polyline &polyline() const;
 
+    //! Returns the number of added points.
+    size_t pointCount() const;
+
     //! Clears the list of points.
     void clear();
 
     //! Returns the result of encoding of the given polyline.
     static std::string encode(const Polyline &polyline);
 
+    //! Appends the result of encoding of the given polyline to the \p result string.
+    /*!
+        The string is grown once by the worst-case size of the encoded polyline,
+        so encoding into a reused string with enough capacity does not allocate.
+        The points are encoded in batches with the branch-free encoder.
+        The string can have any allocator, e.g. be a PmrString.
+    */
+    template<typename Allocator>
+    static void encode(const Polyline &polyline, BasicString<Allocator> &result);
+
+    //! Writes the result of encoding of the given polyline to the \p out iterator.
+    /*!
+        \param polyline The polyline to encode.
+        \param out      The output iterator, for example a pointer to a buffer of at least
+                        maxEncodedSize(polyline.size()) characters.
+        \returns The iterator past the last written character.
+    */
+    template<typename OutputIt>
+    static OutputIt encode(const Polyline &polyline, OutputIt out);
+
     //! Returns the result of encoding of the given polyline.
     /*!
         This generic function accepts a range of elements [first, last) to encode.
+        The accessors are invoked as std::invoke() does: they can be pointers to data
+        members, pointers to member functions or any callables taking the element.
+        The elements are accessed by reference and never copied, with the constness
+        the iterators give them, so mutable ranges accept non-const accessors too. Any input iterators
+        are accepted, the string is grown once only if the range can be measured
+        without consuming it (forward iterators).
         \param first The first element in the range
         \param last  The last element in the range
-        \param getLat Function that returns the element's latitude
-        \param getLon Function that return the element's longitude
+        \param getLat Accessor that returns the element's latitude
+        \param getLon Accessor that returns the element's longitude
         \returns The result of encoding of the given elements.
     */
-    template<typename RandomIt, typename GetLat, typename GetLon>
-    static std::string encode(RandomIt first, RandomIt last, GetLat && getLat, GetLon && getLon);
+    template<typename InputIt, typename GetLat, typename GetLon>
+    static std::string encode(InputIt first, InputIt last, GetLat && getLat, GetLon && getLon);
+
+    //! Appends the result of encoding of the given range of elements to the \p result string.
+    template<typename InputIt, typename GetLat, typename GetLon, typename Allocator>
+    static void encode(InputIt first, InputIt last, GetLat && getLat, GetLon && getLon,
+                       BasicString<Allocator> &result);
+
+    //! Writes the result of encoding of the given range of elements to the \p out iterator.
+    /*!
+        \returns The iterator past the last written character.
+    */
+    template<typename InputIt, typename GetLat, typename GetLon, typename OutputIt>
+    static OutputIt encode(InputIt first, InputIt last, GetLat && getLat, GetLon && getLon,
+                           OutputIt out);
+
+    //! Returns the maximum number of characters needed to encode \p pointCount points.
+    /*!
+        The estimation assumes that the coordinates are within their valid ranges
+        (±90.0° for latitudes and ±180.0° for longitudes). The functions that append
+        to strings grow them by exactly this many characters, so a string that has
+        this capacity reserved is never reallocated. Coordinates out of range may
+        take more characters, and then the string grows as needed.
+    */
+    static constexpr size_t maxEncodedSize(size_t pointCount);
+
+    //! Returns the exact number of characters of the encoded \p polyline without encoding it.
+    static size_t encodedSize(const Polyline &polyline);
 
     //! Returns polyline decoded from the given \p coordinates string.
+    /*!
+        Invalid strings result in an empty polyline.
+    */
     static Polyline decode(const std::string &coordinates);
 
+    //! Appends the points decoded from the given \p coordinates string to the \p polyline.
+    /*!
+        Unlike the overload above, the decoding stops at the first error, but the
+        points decoded so far are kept. Nothing throws, except for the allocator.
+        The \p polyline can have any allocator, e.g. be a PmrPolyline.
+        \returns The status and the position of the first error.
+    */
+    template<typename Allocator>
+    static Result decode(const std::string &coordinates, std::vector<Point, Allocator> &polyline);
+
+    //! Appends the points decoded from the \p size characters of \p data to the \p polyline.
+    template<typename Allocator>
+    static Result decode(const char *data, size_t size, std::vector<Point, Allocator> &polyline);
+
+    //! Checks whether the \p size characters of \p data form a valid polyline, without decoding it.
+    /*!
+        Nothing is allocated, thus the check is cheaper than the decoding and can be
+        used to reject bad input early.
+        \returns The status and the position of the first error.
+    */
+    static Result validate(const char *data, size_t size);
+
+    //! Checks whether the given \p coordinates string is a valid polyline.
+    static Result validate(const std::string &coordinates);
+
+    //! Computes the bounding box of the polyline given by the \p coordinates string.
+    /*!
+        The box is computed while decoding, no points are created. The box of an
+        empty polyline has all coordinates zero.
+        \returns The result of decoding, the \p box covers the points before the error.
+    */
+    static Result bbox(const std::string &coordinates, BoundingBox &box);
+
+    //! Returns the number of points of the polyline given by the \p coordinates string.
+    /*!
+        The points are counted by their last characters without decoding, thus
+        the result is meaningful for valid polylines only.
+    */
+    static size_t pointCount(const std::string &coordinates);
+
+    //! Computes the length of the polyline given by the \p coordinates string in meters.
+    /*!
+        The distances between points are computed with the haversine formula on a
+        sphere of the mean Earth radius.
+        \returns The result of decoding, the length covers the points before the error.
+    */
+    static Result lengthMeters(const std::string &coordinates, double &meters);
+
+    //! Finds the first and the last points of the polyline given by the \p coordinates string.
+    /*!
+        The offsets of all points are accumulated, but no points are created.
+        Both points are zero for an empty polyline.
+        \returns The result of decoding, the \p last point is the one before the error.
+    */
+    static Result firstLast(const std::string &coordinates, PointE5 &first, PointE5 &last);
+
+    //! Returns the encoded polyline of the points of \p first followed by the points of \p second.
+    /*!
+        Only the first point of the \p second polyline is re-encoded, all other
+        characters are copied as is once they are validated. The \p first polyline
+        is scanned to find its last point, but not re-encoded.
+        \returns An empty string if the polylines are invalid.
+    */
+    static std::string concat(const std::string &first, const std::string &second);
+
+    //! Returns the encoded polyline of the points in the [\p begin, \p end) range of the \p coordinates.
+    /*!
+        Only the first point of the range is re-encoded, the points before it are
+        scanned and the rest of the range is validated and copied as is. The points
+        after the range are not examined. The range is clamped to the number of points.
+        \returns An empty string if the polyline is invalid up to the end of the range,
+                 or the range is empty.
+    */
+    static std::string slice(const std::string &coordinates, size_t begin, size_t end);
+
+    //! Returns the encoded polyline with the points in the [\p begin, \p end) range of the
+    //! \p coordinates replaced by the points of the \p insert polyline.
+    /*!
+        Only the first points of the \p insert polyline and of the rest of the
+        \p coordinates after the range are re-encoded, all other characters are
+        validated and copied as is. An empty range inserts the points, an empty
+        \p insert removes them.
+        \returns An empty string if the polylines are invalid.
+    */
+    static std::string splice(const std::string &coordinates, size_t begin, size_t end,
+                              const std::string &insert);
+
+    //! Returns the result of encoding of the given fixed-point polyline.
+    /*!
+        The integer coordinates are used as is, thus the deltas between points
+        are computed exactly and no rounding takes place.
+    */
+    static std::string encodeE5(const PolylineE5 &polyline);
+
+    //! Appends the result of encoding of the given fixed-point polyline to the \p result string.
+    template<typename Allocator>
+    static void encodeE5(const PolylineE5 &polyline, BasicString<Allocator> &result);
+
+    //! Writes the result of encoding of the given fixed-point polyline to the \p out iterator.
+    /*!
+        \returns The iterator past the last written character.
+    */
+    template<typename OutputIt>
+    static OutputIt encodeE5(const PolylineE5 &polyline, OutputIt out);
+
+    //! Returns fixed-point polyline decoded from the given \p coordinates string.
+    /*!
+        The coordinates are accumulated in integers, so no rounding errors are
+        introduced even for very long polylines.
+    */
+    static PolylineE5 decodeE5(const std::string &coordinates);
+
+    //! Appends the fixed-point points decoded from the given \p coordinates string to the \p polyline.
+    /*!
+        The decoding stops at the first error, but the points decoded so far are kept.
+        \returns The status and the position of the first error.
+    */
+    template<typename Allocator>
+    static Result decodeE5(const std::string &coordinates, std::vector<PointE5, Allocator> &polyline);
+
+    //! Appends the fixed-point points decoded from the \p size characters of \p data to the \p polyline.
+    template<typename Allocator>
+    static Result decodeE5(const char *data, size_t size, std::vector<PointE5, Allocator> &polyline);
+
+#ifdef POLYLINEENCODER_CXX17
+    //! Returns the encoded \p points given as {latitude, longitude} pairs in decimal degrees.
+    /*!
+        Can be evaluated at compile time, so that the encoded polyline is stored in
+        read-only data, e.g.:
+        \code
+        constexpr auto route = PolylineEncoder<>::encodeFixed({ { 38.5, -120.2 }, { 40.7, -120.95 } });
+        \endcode
+        The result is the same as of encode(), but points out of range result in an empty string.
+        \returns FixedString<maxEncodedSize(Count)>
+    */
+    template<size_t Count>
+    static constexpr auto encodeFixed(const double (&points)[Count][2]);
+
+    //! Returns the encoded fixed-point \p points, can be evaluated at compile time.
+    /*!
+        \returns FixedString<maxEncodedSize(Count)>
+    */
+    template<size_t Count>
+    static constexpr auto encodeFixedE5(const PointE5 (&points)[Count]);
+
+    //! Returns up to \p Capacity points decoded from the given \p coordinates, can be evaluated at compile time.
+    /*!
+        The decoding stops at the first error, as decode() with a result does.
+        The Overflow status is also reported if the string has more than \p Capacity points.
+    */
+    template<size_t Capacity>
+    static constexpr FixedPolyline<Capacity> decodeFixed(std::string_view coordinates);
+#endif
+
+    //! Returns the result of encoding of the points given by separate coordinate arrays.
+    /*!
+        \param latitudes  The array of \p count latitudes.
+        \param longitudes The array of \p count longitudes.
+        \param count      The number of points.
+    */
+    static std::string encodeColumns(const double *latitudes, const double *longitudes, size_t count);
+
+    //! Appends the result of encoding of the points given by separate coordinate arrays to the \p result string.
+    template<typename Allocator>
+    static void encodeColumns(const double *latitudes, const double *longitudes, size_t count,
+                              BasicString<Allocator> &result);
+
+    //! Returns the result of encoding of the fixed-point points given by separate coordinate arrays.
+    static std::string encodeColumnsE5(const int32_t *latitudes, const int32_t *longitudes, size_t count);
+
+    //! Appends the result of encoding of the fixed-point points given by separate coordinate arrays
+    //! to the \p result string.
+    template<typename Allocator>
+    static void encodeColumnsE5(const int32_t *latitudes, const int32_t *longitudes, size_t count,
+                                BasicString<Allocator> &result);
+
+    //! Returns the result of encoding of the \p polyline simplified with the given \p tolerance.
+    /*!
+        The points are reduced with the Douglas-Peucker algorithm: the points that are
+        closer than the \p tolerance to the simplified polyline are dropped, the first
+        and the last points are always kept. The distances are computed on the
+        fixed-point coordinates, treating them as planar, so the \p tolerance is in
+        decimal degrees. Only the kept points are encoded, no simplified polyline
+        is created.
+    */
+    static std::string encodeSimplified(const Polyline &polyline, double tolerance);
+
+    //! Appends the result of encoding of the \p polyline simplified with the given \p tolerance
+    //! to the \p result string.
+    template<typename Allocator>
+    static void encodeSimplified(const Polyline &polyline, double tolerance, BasicString<Allocator> &result);
+
+    //! Returns the result of encoding of the fixed-point \p polyline simplified with the given
+    //! \p tolerance in decimal degrees.
+    static std::string encodeSimplifiedE5(const PolylineE5 &polyline, double tolerance);
+
+    //! Appends the result of encoding of the fixed-point \p polyline simplified with the given
+    //! \p tolerance in decimal degrees to the \p result string.
+    template<typename Allocator>
+    static void encodeSimplifiedE5(const PolylineE5 &polyline, double tolerance,
+                                   BasicString<Allocator> &result);
+
+    //! Returns the polyline decoded from the given \p coordinates string as separate coordinate columns.
+    /*!
+        The coordinates are written directly to the columns, no points are constructed.
+        Invalid strings result in empty columns.
+    */
+    static Columns decodeColumns(const std::string &coordinates);
+
+    //! Returns the fixed-point polyline decoded from the given \p coordinates string
+    //! as separate coordinate columns.
+    static ColumnsE5 decodeColumnsE5(const std::string &coordinates);
+
+    //! Converts the given decimal degrees to the fixed-point representation.
+    static int32_t toE5(double degrees);
+
+    //! Converts the given fixed-point value to decimal degrees.
+    static POLYLINEENCODER_CONSTEXPR double fromE5(int32_t value);
+
     struct Precision
     {
         static constexpr int Value = PolylineEncoder<Digits - 1>::Precision::Value * 10;
     };
 
 private:
-    //! Encodes a single value according to the compression algorithm.
-    static std::string encode(double value);
+    //! Encodes a single fixed-point value according to the compression algorithm.
+    template<typename OutputIt>
+    static POLYLINEENCODER_CONSTEXPR OutputIt encode(int32_t value, OutputIt out);
+
+    //! Encodes the offset of the \p point from the \p previous one and updates the latter.
+    template<typename OutputIt>
+    static POLYLINEENCODER_CONSTEXPR OutputIt encode(const PointE5 &point, PointE5 &previous, OutputIt out);
+
+    //! Returns the number of chunks required to encode the given zigzag encoded value.
+    static constexpr int chunkCount(uint64_t value);
+
+    //! Returns the zigzag encoded value: the sign is moved to the lowest bit (3), (4), (5).
+    static POLYLINEENCODER_CONSTEXPR uint32_t zigzag(int32_t value);
+
+#ifdef POLYLINEENCODER_CXX17
+    //! Converts the given decimal degrees to the fixed-point representation as toE5() does,
+    //! but at compile time.
+    static constexpr int32_t roundE5(double degrees);
+#endif
+
+    //! Encodes a batch of \p count points into the buffer and updates the \p previous point.
+    /*!
+        The buffer must have at least bufferSize(count) characters available.
+        \returns The pointer past the last encoded character.
+    */
+    static char *encodeBatch(const PointE5 *points, size_t count, PointE5 &previous, char *out);
+
+    //! Encodes a single zigzag encoded value without branches.
+    /*!
+        All chunks of the value are composed in one 64-bit word and stored at
+        once, thus up to 8 characters are written regardless of the value size.
+    */
+    static char *encodeZigzag(uint32_t value, char *out);
+
+    //! Returns the number of chunks of the zigzag encoded value, computed without branches.
+    static int valueSize(uint32_t value);
+
+    //! Returns the size of the buffer used by the batch encoder for \p pointCount points.
+    /*!
+        The longest values of any coordinates, plus the room for the last 8-byte
+        store, that may write past the encoded characters.
+    */
+    static size_t bufferSize(size_t pointCount);
+
+    //! Encodes the \p count points into the \p result string after its first \p size characters.
+    /*!
+        The batches are written directly into the string while its size leaves room
+        for the worst case, the rest are encoded aside and copied, so that the string
+        is grown only if the encoded points do not fit in it.
+        \returns The size of the string with the encoded points.
+    */
+    template<typename Allocator>
+    static size_t encodeInto(BasicString<Allocator> &result, size_t size, const PointE5 *points, size_t count,
+                             PointE5 &previous);
+
+    //! Appends \p count points, that the \p getPoint function returns by index, to the \p result string.
+    template<typename GetPoint, typename Allocator>
+    static void encodeIndexed(size_t count, GetPoint &&getPoint, BasicString<Allocator> &result);
+
+    //! Appends the offset of the \p point from the previous one to the encoded polyline.
+    void append(const PointE5 &point);
+
+    //! The class of the \p Member pointer.
+    template<typename Member>
+    struct MemberClass;
+
+    template<typename Type, typename Class>
+    struct MemberClass<Type Class::*>
+    {
+        using type = Class;
+    };
+
+    //! Returns the object of the \p Class that the \p element is or refers to.
+    /*!
+        As INVOKE does, the member pointers apply to the \p element itself if it is
+        an object of the class, to the object it wraps in std::reference_wrapper, or to
+        the object it points to otherwise: pointers, smart pointers and alike.
+    */
+    template<typename Class, typename Element>
+    static auto object(Element &element)
+        -> typename std::enable_if<std::is_base_of<Class, typename std::remove_cv<Element>::type>::value,
+                                   Element &>::type;
+
+    template<typename Class, typename Wrapped>
+    static Wrapped &object(const std::reference_wrapper<Wrapped> &element);
+
+    template<typename Class, typename Element>
+    static auto object(Element &element)
+        -> typename std::enable_if<!std::is_base_of<Class, typename std::remove_cv<Element>::type>::value,
+                                   decltype(*element)>::type;
+
+    //! Returns the value of the data member pointed by \p getter of the \p element.
+    template<typename Getter, typename Element>
+    static auto get(Getter getter, Element &element)
+        -> typename std::enable_if<std::is_member_object_pointer<Getter>::value,
+                                   decltype(object<typename MemberClass<Getter>::type>(element).*getter)>::type;
+
+    //! Returns the result of the member function pointed by \p getter of the \p element.
+    template<typename Getter, typename Element>
+    static auto get(Getter getter, Element &element)
+        -> typename std::enable_if<std::is_member_function_pointer<Getter>::value,
+                                   decltype((object<typename MemberClass<Getter>::type>(element).*getter)())>::type;
+
+    //! Returns the result of the \p getter called with the \p element.
+    template<typename Getter, typename Element>
+    static auto get(Getter &&getter, Element &element)
+        -> typename std::enable_if<!std::is_member_pointer<typename std::decay<Getter>::type>::value,
+                                   decltype(std::forward<Getter>(getter)(element))>::type;
+
+    //! Returns the fixed-point point of the \p element with the coordinates given by the accessors.
+    /*!
+        The \p element is whatever the iterator dereferences to. It is passed to both
+        accessors as an lvalue of its own constness, so non-const member functions
+        and callables taking non-const references are accepted for mutable ranges.
+    */
+    template<typename Element, typename GetLat, typename GetLon>
+    static PointE5 toE5(Element &&element, GetLat &getLat, GetLon &getLon);
+
+    //! Returns the number of elements in the range, or zero if it cannot be measured without consuming it.
+    template<typename InputIt>
+    static size_t rangeSize(InputIt first, InputIt last, std::input_iterator_tag);
+
+    template<typename InputIt>
+    static size_t rangeSize(InputIt first, InputIt last, std::forward_iterator_tag);
+
+    //! Decodes up to \p count points and accumulates their offsets in the \p point.
+    /*!
+        The \p count is decreased by the number of decoded points.
+        \returns false if the points are invalid.
+    */
+    static bool advance(const char *&it, const char *end, size_t &count, PointE5 &point);
+
+    //! Appends the encoded points [\p first, \p last) to the \p result, which ends with the \p previous point.
+    /*!
+        The first point is re-encoded, as its offset is from the \p origin point
+        that precedes it in the source string, the rest are validated and copied.
+        \returns false if any of the points is invalid.
+    */
+    static bool rebase(const char *first, const char *last, const PointE5 &origin, const PointE5 &previous,
+                       std::string &result);
+
+    //! Returns the indices of the points kept by the Douglas-Peucker simplification.
+    /*!
+        \param tolerance The tolerance in the fixed-point units.
+    */
+    static std::vector<size_t> simplify(const PointE5 *points, size_t count, double tolerance);
+
+    //! Returns the squared distance from the \p point to the segment between \p first and \p last.
+    static double distanceSquared(const PointE5 &point, const PointE5 &first, const PointE5 &last);
+
+    //! Returns the number of points counted by the characters without the continuation bit.
+    static size_t countPoints(const char *data, size_t size);
+
+    //! Decodes the current fixed-point value out of string and advances the \p it.
+    /*!
+        On failure the \p it points to the offending character or, if the value is
+        incomplete, to its first character.
+    */
+    static POLYLINEENCODER_CONSTEXPR Status decode(const char *&it, const char *end, int32_t &value);
+
+    //! Decodes both offsets of the next point out of the next 8 characters at once, if possible.
+    /*!
+        \returns false if the values do not fit into the 8 characters or contain
+        invalid characters, so that the caller falls back to the regular decoding.
+    */
+    static bool decodeWord(const char *&it, int32_t &latitude, int32_t &longitude);
+
+    //! Returns the value out of the 5-bit chunks stored in the bytes of the \p word.
+    static int32_t decodeChunks(uint64_t word);
+
+    //! Returns the index of the lowest byte that has a set bit in the non-zero \p word.
+    static int lowestByte(uint64_t word);
+
+    //! Decodes the offsets of the next point out of string and advances the \p it.
+    /*!
+        The offsets are not checked, only the resulting coordinates can be.
+        On failure the \p it points to the error as decode() does.
+    */
+    static Status decodePoint(const char *&it, const char *end, int32_t &latDelta, int32_t &lonDelta);
+
+    //! Returns true if the coordinates, accumulated in modular arithmetic, are within their ranges.
+    static POLYLINEENCODER_CONSTEXPR bool isValid(uint32_t latitude, uint32_t longitude);
 
-    //! Decodes the current decimal value out of string.
-    static double decode(const std::string &coords, size_t &i);
+    //! Decodes all points of the string and passes them to the \p emit function.
+    /*!
+        The decoding stops at the first error.
+    */
+    template<typename Emit>
+    static Result decodePoints(const char *first, const char *last, Emit &&emit);
 
     //! Store the polyline - the list of points.
     Polyline m_polyline;
 
+    //! The encoded polyline and its last point, to encode the next offset from.
+    std::string m_encoded;
+    PointE5 m_previous{ 0, 0 };
+    size_t m_pointCount{ 0 };
+    bool m_keepPoints{ true };
+
+    template<int> friend class PolylineDecoder;
+    template<int> friend class PolylineView;
+    template<int> friend class PolylineBatch;
+    template<int> friend class PolylineReader;
+    template<int> friend class PolylineBinary;
+    template<int> friend class PolylineIndex;
+    friend class PolylineCodec;
+
     //! Constants
     static constexpr const int s_chunkSize   = 5;
     static constexpr const int s_asciiOffset = 63;
     static constexpr const int s_5bitMask    = 0x1f; // 0b11111 = 31
     static constexpr const int s_6bitMask    = 0x20; // 0b100000 = 32
+
+    //! The bounds of the coordinates in the fixed-point representation.
+    static constexpr const int64_t s_maxLatitude  = 90LL * Precision::Value;
+    static constexpr const int64_t s_maxLongitude = 180LL * Precision::Value;
+
+    //! The mean Earth radius in meters.
+    static constexpr const double s_earthRadius = 6371008.8;
+
+    //! The number of chunks of the longest 32-bit value.
+    static constexpr const int s_maxChunks = 7;
+
+    //! The number of points processed by the batch encoder at once.
+    static constexpr const int s_batchSize = 8;
+
+    //! The longest encoded value: the longitude difference of 360° (zigzag encoded),
+    //! but not more than the 32-bit value may take.
+    static constexpr const int s_maxValueSize =
+        chunkCount(720ULL * Precision::Value) < s_maxChunks ? chunkCount(720ULL * Precision::Value)
+                                                            : s_maxChunks;
 };
 
 // A bogus class for compile-time precision calculations.
@@ -149,197 +815,1782 @@ public:
     };
 };
 
-///////////////////////////////////////////////////////////////////////////////
-// PolylineEncoder implementation
-///////////////////////////////////////////////////////////////////////////////
-template<int Digits>
-PolylineEncoder<Digits>::Point::Point(double latitude, double longitude)
-    : m_latitude(std::round(latitude *Precision::Value) / Precision::Value)
-    , m_longitude(std::round(longitude *Precision::Value) / Precision::Value)
+//! Decodes an encoded polyline incrementally, chunk by chunk.
+/*!
+    The input can be split at arbitrary characters: the partially decoded value
+    and the previous point are kept between the calls. Decoded points are passed
+    to the callback as soon as they are complete, so the whole encoded string
+    never has to be in memory.
+*/
+template<int Digits = 5>
+class PolylineDecoder
 {
-    assert(latitude <= 90.0 && latitude >= -90.0);
-    assert(longitude <= 180.0 && longitude >= -180.0);
-}
+public:
+    using Encoder = PolylineEncoder<Digits>;
+    using Point   = typename Encoder::Point;
+    using PointE5 = typename Encoder::PointE5;
 
-template<int Digits>
-double PolylineEncoder<Digits>::Point::latitude() const
-{
-    return m_latitude;
-}
+    //! Decodes the next chunk of the encoded polyline.
+    /*!
+        \param data The chunk of the encoded polyline.
+        \param size The number of characters in the chunk.
+        \param emit The function that is called with each decoded Point.
+        \returns false if the input is not a valid polyline. The decoder ignores
+                 further input once it failed, until it is reset.
+    */
+    template<typename Emit>
+    bool decode(const char *data, size_t size, Emit &&emit);
 
-template<int Digits>
-double PolylineEncoder<Digits>::Point::longitude() const
-{
-    return m_longitude;
-}
+    //! Decodes the next chunk of the encoded polyline.
+    template<typename Emit>
+    bool decode(const std::string &chunk, Emit &&emit);
 
-template<int Digits>
-void PolylineEncoder<Digits>::addPoint(double latitude, double longitude)
-{
-    m_polyline.emplace_back(latitude, longitude);
-}
+    //! Decodes the next chunk of the encoded polyline into fixed-point points.
+    /*!
+        \param emit The function that is called with each decoded PointE5.
+    */
+    template<typename Emit>
+    bool decodeE5(const char *data, size_t size, Emit &&emit);
 
-template<int Digits>
-std::string PolylineEncoder<Digits>::encode() const
-{
-    return encode(m_polyline);
-}
+    //! Returns true if all input so far forms a valid polyline, without incomplete points.
+    bool isComplete() const;
 
-template<int Digits>
-std::string PolylineEncoder<Digits>::encode(double value)
-{
-    int32_t e5 =
-        std::round(value * Precision::Value);     // (2)
+    //! Returns true if the input is not a valid polyline.
+    bool hasFailed() const;
 
-    const bool negativeValue = value < 0;
+    //! Returns the number of points decoded so far.
+    size_t pointCount() const;
 
-    if (negativeValue) {
-        // Negative value must be calculated using
-        // its two's complement by inverting the
-        // binary value and adding one to the
-        // result                                 // (3)
+    //! Resets the decoder to decode a new polyline.
+    void reset();
 
-        e5 *= -1; // Starting with the equivalent positive number;
-        e5 = ~e5; // Inverting (or flipping) all bits – changing every 0 to 1, and every 1 to 0;
-        e5 += 1;  // Adding 1 to the entire inverted number.
-    }
+private:
+    //! Stores the decoded \p value and emits the point once both its values are decoded.
+    template<typename Emit>
+    bool push(int32_t value, Emit &emit);
 
-    e5 <<= 1;                                     // (4)
+    //! The partially decoded value.
+    uint32_t m_value{ 0 };
+    int m_shift{ 0 };
 
-    if (negativeValue) {
-        e5 = ~e5;                                 // (5)
-    }
+    //! The decoded latitude offset that waits for the longitude.
+    int32_t m_latitudeDelta{ 0 };
+    bool m_hasLatitude{ false };
 
-    bool hasNextChunk = false;
-    std::string result;
+    //! The previous point, accumulated in modular arithmetic.
+    uint32_t m_latitude{ 0 };
+    uint32_t m_longitude{ 0 };
 
-    // Split the value into 5-bit chunks and convert each of them to integer
-    do {
-        int32_t nextChunk = (e5 >> s_chunkSize); // (6), (7) - start from the left 5 bits.
-        hasNextChunk = nextChunk > 0;
+    size_t m_pointCount{ 0 };
+    bool m_failed{ false };
+};
 
-        int charVar = e5 & s_5bitMask;           // 5-bit mask (0b11111 == 31). Extract the left 5 bits.
+//! A lazy, non-owning view of an encoded polyline.
+/*!
+    The points are decoded on demand while iterating, without any allocations,
+    so that consumers that need only some of the points do not pay for decoding
+    of the whole polyline. The view does not own the encoded string, which must
+    outlive the view. The iteration stops at the first invalid point.
+*/
+template<int Digits = 5>
+class PolylineView
+{
+public:
+    using Encoder = PolylineEncoder<Digits>;
+    using Point   = typename Encoder::Point;
+    using PointE5 = typename Encoder::PointE5;
+
+    //! The input iterator that decodes the points one by one.
+    /*!
+        The points are decoded into the iterator itself, so they are returned by
+        value: equal iterators yield equal points, and no reference outlives the
+        iterator it was taken from. The copies of an iterator can still be advanced
+        independently, but without references to the points it is not a forward
+        iterator.
+    */
+    class Iterator
+    {
+    public:
+        //! Holds a copy of the current point for the member access.
+        class Pointer
+        {
+        public:
+            const Point *operator->() const { return &m_point; }
+
+        private:
+            friend class Iterator;
+
+            explicit Pointer(const Point &point) : m_point(point) {}
+
+            Point m_point;
+        };
+
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = Point;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = Pointer;
+        using reference         = Point;
+
+        //! Creates the end iterator.
+        Iterator() = default;
+
+        reference operator*() const;
+        pointer operator->() const;
+
+        //! Returns the current point in the fixed-point representation.
+        PointE5 e5() const;
+
+        Iterator &operator++();
+        Iterator operator++(int);
+
+        bool operator==(const Iterator &other) const;
+        bool operator!=(const Iterator &other) const;
+
+    private:
+        friend class PolylineView;
+
+        Iterator(const char *data, const char *end);
+
+        //! Decodes the next point or turns into the end iterator.
+        void advance();
+
+        //! The position right after the current point.
+        const char *m_it{ nullptr };
+        const char *m_end{ nullptr };
+
+        //! The current point, accumulated in modular arithmetic.
+        uint32_t m_latitude{ 0 };
+        uint32_t m_longitude{ 0 };
+        Point m_point = Point::fromE5(0, 0);
+
+        bool m_atEnd{ true };
+    };
+
+    using iterator       = Iterator;
+    using const_iterator = Iterator;
+
+    //! Creates an empty view.
+    PolylineView() = default;
+
+    //! Creates a view of \p size characters of the encoded polyline.
+    PolylineView(const char *data, size_t size);
+
+    //! Creates a view of the encoded polyline string.
+    PolylineView(const std::string &coords);
+
+#ifdef POLYLINEENCODER_CXX17
+    //! Creates a view of the encoded polyline string.
+    PolylineView(std::string_view coords);
+#endif
+
+    Iterator begin() const;
+    Iterator end() const;
+
+    //! Returns true if the view has no characters.
+    bool empty() const;
+
+    //! Returns the number of points.
+    /*!
+        The points are counted by their last characters without decoding, thus
+        the result is meaningful for valid polylines only.
+    */
+    size_t count() const;
+
+    //! Returns the first point. The view must not be empty.
+    Point front() const;
+
+    //! Returns the last point. The view must not be empty.
+    /*!
+        All offsets are accumulated in integers, but no points are constructed
+        except the last one.
+    */
+    Point back() const;
+
+    //! Returns the viewed characters.
+    const char *data() const;
+
+    //! Returns the number of the viewed characters.
+    size_t size() const;
+
+private:
+    const char *m_data{ nullptr };
+    size_t m_size{ 0 };
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PolylineEncoder implementation
+///////////////////////////////////////////////////////////////////////////////
+template<int Digits>
+PolylineEncoder<Digits>::Point::Point(double latitude, double longitude)
+    : m_latitude(std::round(latitude *Precision::Value) / Precision::Value)
+    , m_longitude(std::round(longitude *Precision::Value) / Precision::Value)
+{
+    assert(latitude <= 90.0 && latitude >= -90.0);
+    assert(longitude <= 180.0 && longitude >= -180.0);
+}
+
+template<int Digits>
+double PolylineEncoder<Digits>::Point::latitude() const
+{
+    return m_latitude;
+}
+
+template<int Digits>
+double PolylineEncoder<Digits>::Point::longitude() const
+{
+    return m_longitude;
+}
+
+template<int Digits>
+typename PolylineEncoder<Digits>::Point PolylineEncoder<Digits>::Point::fromE5(int32_t latitude,
+                                                                               int32_t longitude)
+{
+    Point point;
+    point.m_latitude = PolylineEncoder::fromE5(latitude);
+    point.m_longitude = PolylineEncoder::fromE5(longitude);
+    return point;
+}
+
+template<int Digits>
+PolylineEncoder<Digits>::PolylineEncoder(bool keepPoints)
+    : m_keepPoints(keepPoints)
+{}
+
+template<int Digits>
+void PolylineEncoder<Digits>::addPoint(double latitude, double longitude)
+{
+    if (m_keepPoints) {
+        m_polyline.emplace_back(latitude, longitude);
+    }
+    append(PointE5{ toE5(latitude), toE5(longitude) });
+}
+
+template<int Digits>
+void PolylineEncoder<Digits>::addPointE5(int32_t latitude, int32_t longitude)
+{
+    if (m_keepPoints) {
+        m_polyline.push_back(Point::fromE5(latitude, longitude));
+    }
+    append(PointE5{ latitude, longitude });
+}
+
+template<int Digits>
+void PolylineEncoder<Digits>::append(const PointE5 &point)
+{
+#ifdef POLYLINEENCODER_ENABLE_STATS
+    PolylineStats::Scope scope(PolylineStats::Operation::Encode);
+#endif
+
+    const size_t size = m_encoded.size();
+    m_encoded.resize(size + bufferSize(1));
+    char *begin = &m_encoded[0];
+    char *end = encodeBatch(&point, 1, m_previous, begin + size);
+    m_encoded.resize(end - begin);
+
+    ++m_pointCount;
+}
+
+template<int Digits>
+std::string PolylineEncoder<Digits>::encode() const
+{
+    return m_encoded;
+}
+
+template<int Digits>
+const std::string &PolylineEncoder<Digits>::encoded() const
+{
+    return m_encoded;
+}
+
+template<int Digits>
+int32_t PolylineEncoder<Digits>::toE5(double degrees)
+{
+    return static_cast<int32_t>(std::round(degrees * Precision::Value)); // (2)
+}
+
+template<int Digits>
+POLYLINEENCODER_CONSTEXPR double PolylineEncoder<Digits>::fromE5(int32_t value)
+{
+    return value / static_cast<double>(Precision::Value);
+}
+
+template<int Digits>
+template<typename OutputIt>
+POLYLINEENCODER_CONSTEXPR OutputIt PolylineEncoder<Digits>::encode(int32_t value, OutputIt out)
+{
+    uint32_t e5 = zigzag(value);
+
+    bool hasNextChunk = false;
+
+    // Split the value into 5-bit chunks and convert each of them to integer
+    do {
+        uint32_t nextChunk = (e5 >> s_chunkSize); // (6), (7) - start from the left 5 bits.
+        hasNextChunk = nextChunk > 0;
+
+        int charVar = e5 & s_5bitMask;            // 5-bit mask (0b11111 == 31). Extract the left 5 bits.
         if (hasNextChunk) {
-            charVar |= s_6bitMask;               // (8)
+            charVar |= s_6bitMask;                // (8)
         }
-        charVar += s_asciiOffset;                // (10)
-        result += (char)charVar;                 // (11)
+        charVar += s_asciiOffset;                 // (10)
+        *out++ = (char)charVar;                   // (11)
 
         e5 = nextChunk;
     } while (hasNextChunk);
 
-    return result;
+    return out;
 }
 
 template<int Digits>
-template<typename RandomIt, typename GetLat, typename GetLon>
-std::string PolylineEncoder<Digits>::encode(RandomIt first, RandomIt last,
-                                            GetLat && getLat, GetLon && getLon)
+template<typename OutputIt>
+POLYLINEENCODER_CONSTEXPR OutputIt PolylineEncoder<Digits>::encode(const PointE5 &point, PointE5 &previous,
+                                                                   OutputIt out)
 {
-    std::string result;
+    // Offset from the previous point. The differences are computed in modular
+    // arithmetic, so they cannot overflow and the decoder restores the points exactly.
+    const auto latDelta = static_cast<uint32_t>(point.latitude) - static_cast<uint32_t>(previous.latitude);
+    const auto lonDelta = static_cast<uint32_t>(point.longitude) - static_cast<uint32_t>(previous.longitude);
 
-    // The first segment: offset from (.0, .0)
-    double latPrev = .0;
-    double lonPrev = .0;
+    out = encode(static_cast<int32_t>(latDelta), out);
+    out = encode(static_cast<int32_t>(lonDelta), out);
 
-    while (first != last) {
-        auto getLatFunc = std::bind(getLat, *first);
-        const auto lat = getLatFunc();
-        auto getLonFunc = std::bind(getLon, *first);
-        const auto lon = getLonFunc();
+    previous = point;
+    return out;
+}
+
+template<int Digits>
+POLYLINEENCODER_CONSTEXPR uint32_t PolylineEncoder<Digits>::zigzag(int32_t value)
+{
+    // Negative values are already in two's complement form (3).
+    const uint32_t e5 = static_cast<uint32_t>(value) << 1; // (4)
+    return value < 0 ? ~e5 : e5;                           // (5)
+}
+
+template<int Digits>
+int PolylineEncoder<Digits>::valueSize(uint32_t value)
+{
+    return 1 + (value >= 1U << 5) + (value >= 1U << 10) + (value >= 1U << 15) +
+           (value >= 1U << 20) + (value >= 1U << 25) + (value >= 1U << 30);
+}
+
+template<int Digits>
+char *PolylineEncoder<Digits>::encodeZigzag(uint32_t value, char *out)
+{
+    const int size = valueSize(value);
 
-        // Offset from the previous point
-        result.append(encode(lat - latPrev));
-        result.append(encode(lon - lonPrev));
+    // Spread 5-bit chunks into the bytes: first into 20-bit, then 10-bit and
+    // finally 5-bit groups, the lowest chunk ends up in the lowest byte (6), (7).
+    uint64_t word = (value & 0xfffffULL) | (static_cast<uint64_t>(value >> 20) << 32);
+    word = (word & 0x000003ff000003ffULL) | ((word & 0x000ffc00000ffc00ULL) << 6);
+    word = (word & 0x001f001f001f001fULL) | ((word & 0x03e003e003e003e0ULL) << 3);
 
-        latPrev = lat;
-        lonPrev = lon;
+    // All but the last chunk have the continuation bit (8). No byte overflows
+    // after the offset is added (10).
+    word |= 0x2020202020202020ULL & ((1ULL << (8 * (size - 1))) - 1);
+    word += 0x3f3f3f3f3f3f3f3fULL;
 
-        ++first;
+#ifdef POLYLINEENCODER_LITTLE_ENDIAN
+    std::memcpy(out, &word, sizeof(word));        // (11)
+#else
+    for (int i = 0; i < size; ++i) {
+        out[i] = static_cast<char>(word >> (8 * i)); // (11)
     }
+#endif
+    return out + size;
+}
 
-    return result;
+template<int Digits>
+char *PolylineEncoder<Digits>::encodeBatch(const PointE5 *points, size_t count, PointE5 &previous,
+                                           char *out)
+{
+    uint32_t values[2 * s_batchSize];
+
+#ifdef POLYLINEENCODER_ENABLE_STATS
+    const char *start = out;
+    const size_t pointCount = count;
+    size_t valueSizes[8] = {};
+#endif
+
+    while (count > 0) {
+        const size_t batchSize = count < s_batchSize ? count : s_batchSize;
+
+        // Offsets from the previous points, computed in modular arithmetic.
+        values[0] = zigzag(static_cast<int32_t>(static_cast<uint32_t>(points[0].latitude) -
+                                                static_cast<uint32_t>(previous.latitude)));
+        values[1] = zigzag(static_cast<int32_t>(static_cast<uint32_t>(points[0].longitude) -
+                                                static_cast<uint32_t>(previous.longitude)));
+        for (size_t i = 1; i < batchSize; ++i) {
+            values[2 * i] = zigzag(static_cast<int32_t>(static_cast<uint32_t>(points[i].latitude) -
+                                                        static_cast<uint32_t>(points[i - 1].latitude)));
+            values[2 * i + 1] = zigzag(static_cast<int32_t>(static_cast<uint32_t>(points[i].longitude) -
+                                                            static_cast<uint32_t>(points[i - 1].longitude)));
+        }
+
+        for (size_t i = 0; i < 2 * batchSize; ++i) {
+#ifdef POLYLINEENCODER_ENABLE_STATS
+            const char *value = out;
+            out = encodeZigzag(values[i], out);
+            ++valueSizes[out - value];
+#else
+            out = encodeZigzag(values[i], out);
+#endif
+        }
+
+        previous = points[batchSize - 1];
+        points += batchSize;
+        count -= batchSize;
+    }
+
+#ifdef POLYLINEENCODER_ENABLE_STATS
+    PolylineStats::encoded(pointCount, static_cast<size_t>(out - start), valueSizes);
+#endif
+
+    return out;
 }
 
 template<int Digits>
-std::string PolylineEncoder<Digits>::encode(const typename PolylineEncoder::Polyline &polyline)
+size_t PolylineEncoder<Digits>::bufferSize(size_t pointCount)
 {
-    return encode(polyline.cbegin(), polyline.cend(), &Point::latitude, &Point::longitude);
+    // Reserve for the longest possible values, whatever the coordinates are,
+    // plus the room for the last 8-byte store.
+    return pointCount * 2 * s_maxChunks + sizeof(uint64_t);
 }
 
 template<int Digits>
-double PolylineEncoder<Digits>::decode(const std::string &coords, size_t &i)
+template<typename GetPoint, typename Allocator>
+void PolylineEncoder<Digits>::encodeIndexed(size_t count, GetPoint &&getPoint, BasicString<Allocator> &result)
 {
-    assert(i < coords.size());
+#ifdef POLYLINEENCODER_ENABLE_STATS
+    PolylineStats::Scope scope(PolylineStats::Operation::Encode);
+#endif
 
-    int32_t result = 0;
-    int shift = 0;
-    char c = 0;
-    do {
-        if (i < coords.size()) {
-            c = coords.at(i++);
-            c -= s_asciiOffset;      // (10)
-            result |= (c & s_5bitMask) << shift;
-            shift += s_chunkSize;    // (7)
-        } else {
-            return std::numeric_limits<double>::quiet_NaN();
+    auto size = result.size();
+    result.resize(size + maxEncodedSize(count));
+
+    PointE5 previous{ 0, 0 };
+    PointE5 batch[s_batchSize];
+
+    for (size_t i = 0; i < count;) {
+        size_t batchSize = 0;
+        for (; batchSize < s_batchSize && i < count; ++batchSize, ++i) {
+            batch[batchSize] = getPoint(i);
         }
-    } while (c >= s_6bitMask);
+        size = encodeInto(result, size, batch, batchSize, previous);
+    }
 
-    if (result & 1) {
-        result = ~result;        // (5)
+    result.resize(size);
+}
+
+template<int Digits>
+template<typename Allocator>
+size_t PolylineEncoder<Digits>::encodeInto(BasicString<Allocator> &result, size_t size, const PointE5 *points,
+                                           size_t count, PointE5 &previous)
+{
+    while (count > 0) {
+        const size_t batchSize = count < s_batchSize ? count : s_batchSize;
+        if (result.size() - size >= bufferSize(batchSize)) {
+            char *begin = &result[0];
+            size = static_cast<size_t>(encodeBatch(points, batchSize, previous, begin + size) - begin);
+        } else {
+            // The 8-byte stores could overrun the string near its end.
+            char buffer[2 * s_maxChunks * s_batchSize + sizeof(uint64_t)];
+            const auto length = static_cast<size_t>(encodeBatch(points, batchSize, previous, buffer) - buffer);
+            if (result.size() < size + length) {
+                result.resize(size + length);
+            }
+            std::memcpy(&result[size], buffer, length);
+            size += length;
+        }
+        points += batchSize;
+        count -= batchSize;
     }
-    result >>= 1;                // (4)
+    return size;
+}
+
+template<int Digits>
+double PolylineEncoder<Digits>::distanceSquared(const PointE5 &point, const PointE5 &first, const PointE5 &last)
+{
+    const double dx = static_cast<double>(last.longitude) - first.longitude;
+    const double dy = static_cast<double>(last.latitude) - first.latitude;
+    double px = static_cast<double>(point.longitude) - first.longitude;
+    double py = static_cast<double>(point.latitude) - first.latitude;
 
-    // Convert to decimal value with the given precision.
-    return result / static_cast<double>(Precision::Value); // (2)
+    const double length = dx * dx + dy * dy;
+    if (length > 0.0) {
+        // The projection of the point onto the segment, clamped to its ends.
+        const double t = std::max(0.0, std::min(1.0, (px * dx + py * dy) / length));
+        px -= t * dx;
+        py -= t * dy;
+    }
+    return px * px + py * py;
 }
 
 template<int Digits>
-typename PolylineEncoder<Digits>::Polyline PolylineEncoder<Digits>::decode(const std::string &coords)
+std::vector<size_t> PolylineEncoder<Digits>::simplify(const PointE5 *points, size_t count, double tolerance)
 {
-    PolylineEncoder<Digits>::Polyline polyline;
+    std::vector<size_t> indices;
+    if (count < 3) {
+        for (size_t i = 0; i < count; ++i) {
+            indices.push_back(i);
+        }
+        return indices;
+    }
+
+    std::vector<char> keep(count, 0);
+    keep[0] = 1;
+    keep[count - 1] = 1;
+
+    // The ranges to simplify. The smaller half is always taken first, thus the
+    // stack holds no more than log2(count) ranges.
+    std::vector<std::pair<size_t, size_t>> ranges;
+    ranges.emplace_back(0, count - 1);
 
-    size_t i = 0;
-    while (i < coords.size()) {
-        double lat = decode(coords, i);
-        if (std::isnan(lat) || fabs(lat) > 90.0) {
-            // Invalid latitude, implies invalid polyline string.
-            polyline.clear();
-            break;  // exit while
+    const double toleranceSquared = tolerance * tolerance;
+    while (!ranges.empty()) {
+        const size_t first = ranges.back().first;
+        const size_t last = ranges.back().second;
+        ranges.pop_back();
+
+        size_t farthest = 0;
+        double maxDistance = toleranceSquared;
+        for (size_t i = first + 1; i < last; ++i) {
+            const double distance = distanceSquared(points[i], points[first], points[last]);
+            if (distance > maxDistance) {
+                maxDistance = distance;
+                farthest = i;
+            }
+        }
+        if (farthest == 0) {
+            continue;
         }
 
-        double lon = std::numeric_limits<double>::quiet_NaN();
-        if (i < coords.size()) {
-            lon = decode(coords, i);
+        keep[farthest] = 1;
+        std::pair<size_t, size_t> left(first, farthest);
+        std::pair<size_t, size_t> right(farthest, last);
+        if (farthest - first < last - farthest) {
+            std::swap(left, right);
         }
-        if (std::isnan(lon) || fabs(lon) > 180.0) {
-            // Invalid longitude, implies invalid polyline string.
-            polyline.clear();
-            break;  // exit while
+        if (left.second - left.first > 1) {
+            ranges.push_back(left);
         }
+        if (right.second - right.first > 1) {
+            ranges.push_back(right);
+        }
+    }
 
-        if (!polyline.empty()) {
-            const auto &prevPoint = polyline.back();
-            lat += prevPoint.latitude();
-            lon += prevPoint.longitude();
+    for (size_t i = 0; i < count; ++i) {
+        if (keep[i]) {
+            indices.push_back(i);
         }
-        polyline.emplace_back(lat, lon);
     }
+    return indices;
+}
 
-    return polyline;
+template<int Digits>
+size_t PolylineEncoder<Digits>::countPoints(const char *data, size_t size)
+{
+    // Each point has exactly two characters without the continuation bit.
+    size_t lastChunks = 0;
+    for (size_t i = 0; i < size; ++i) {
+        lastChunks += static_cast<unsigned char>(data[i]) - s_asciiOffset < s_6bitMask;
+    }
+    return lastChunks / 2;
 }
 
 template<int Digits>
-const typename PolylineEncoder<Digits>::Polyline &PolylineEncoder<Digits>::polyline() const
+constexpr int PolylineEncoder<Digits>::chunkCount(uint64_t value)
 {
-    return m_polyline;
+    return value >> s_chunkSize ? 1 + chunkCount(value >> s_chunkSize) : 1;
 }
 
 template<int Digits>
-void PolylineEncoder<Digits>::clear()
+constexpr size_t PolylineEncoder<Digits>::maxEncodedSize(size_t pointCount)
 {
-    m_polyline.clear();
+    return pointCount * 2 * s_maxValueSize;
+}
+
+template<int Digits>
+template<typename InputIt, typename GetLat, typename GetLon>
+std::string PolylineEncoder<Digits>::encode(InputIt first, InputIt last,
+                                            GetLat && getLat, GetLon && getLon)
+{
+    std::string result;
+    encode(first, last, std::forward<GetLat>(getLat), std::forward<GetLon>(getLon), result);
+    return result;
+}
+
+template<int Digits>
+template<typename InputIt, typename GetLat, typename GetLon, typename Allocator>
+void PolylineEncoder<Digits>::encode(InputIt first, InputIt last,
+                                     GetLat && getLat, GetLon && getLon, BasicString<Allocator> &result)
+{
+#ifdef POLYLINEENCODER_ENABLE_STATS
+    PolylineStats::Scope scope(PolylineStats::Operation::Encode);
+#endif
+
+    using Category = typename std::iterator_traits<InputIt>::iterator_category;
+    static_assert(std::is_base_of<std::input_iterator_tag, Category>::value,
+                  "The range must be given by input iterators");
+
+    // Reserve the space for the valid coordinates and write directly into the string's buffer.
+    // A range that cannot be measured grows the string batch by batch.
+    auto size = result.size();
+    result.resize(size + maxEncodedSize(rangeSize(first, last, Category())));
+
+    // The first segment: offset from (.0, .0)
+    PointE5 previous{ 0, 0 };
+    PointE5 batch[s_batchSize];
+
+    while (first != last) {
+        size_t count = 0;
+        for (; count < s_batchSize && first != last; ++count, ++first) {
+            batch[count] = toE5(*first, getLat, getLon);
+        }
+        size = encodeInto(result, size, batch, count, previous);
+    }
+
+    result.resize(size);
+}
+
+template<int Digits>
+template<typename InputIt, typename GetLat, typename GetLon, typename OutputIt>
+OutputIt PolylineEncoder<Digits>::encode(InputIt first, InputIt last,
+                                         GetLat && getLat, GetLon && getLon, OutputIt out)
+{
+    static_assert(std::is_base_of<std::input_iterator_tag,
+                                  typename std::iterator_traits<InputIt>::iterator_category>::value,
+                  "The range must be given by input iterators");
+
+    // The first segment: offset from (.0, .0)
+    PointE5 previous{ 0, 0 };
+
+    for (; first != last; ++first) {
+        // Each coordinate is rounded only once, the offsets are exact.
+        out = encode(toE5(*first, getLat, getLon), previous, out);
+    }
+
+    return out;
+}
+
+template<int Digits>
+template<typename Class, typename Element>
+auto PolylineEncoder<Digits>::object(Element &element)
+    -> typename std::enable_if<std::is_base_of<Class, typename std::remove_cv<Element>::type>::value,
+                               Element &>::type
+{
+    return element;
+}
+
+template<int Digits>
+template<typename Class, typename Wrapped>
+Wrapped &PolylineEncoder<Digits>::object(const std::reference_wrapper<Wrapped> &element)
+{
+    return element.get();
+}
+
+template<int Digits>
+template<typename Class, typename Element>
+auto PolylineEncoder<Digits>::object(Element &element)
+    -> typename std::enable_if<!std::is_base_of<Class, typename std::remove_cv<Element>::type>::value,
+                               decltype(*element)>::type
+{
+    return *element;
+}
+
+template<int Digits>
+template<typename Getter, typename Element>
+auto PolylineEncoder<Digits>::get(Getter getter, Element &element)
+    -> typename std::enable_if<std::is_member_object_pointer<Getter>::value,
+                               decltype(object<typename MemberClass<Getter>::type>(element).*getter)>::type
+{
+    return object<typename MemberClass<Getter>::type>(element).*getter;
+}
+
+template<int Digits>
+template<typename Getter, typename Element>
+auto PolylineEncoder<Digits>::get(Getter getter, Element &element)
+    -> typename std::enable_if<std::is_member_function_pointer<Getter>::value,
+                               decltype((object<typename MemberClass<Getter>::type>(element).*getter)())>::type
+{
+    return (object<typename MemberClass<Getter>::type>(element).*getter)();
+}
+
+template<int Digits>
+template<typename Getter, typename Element>
+auto PolylineEncoder<Digits>::get(Getter &&getter, Element &element)
+    -> typename std::enable_if<!std::is_member_pointer<typename std::decay<Getter>::type>::value,
+                               decltype(std::forward<Getter>(getter)(element))>::type
+{
+    return std::forward<Getter>(getter)(element);
+}
+
+template<int Digits>
+template<typename Element, typename GetLat, typename GetLon>
+typename PolylineEncoder<Digits>::PointE5 PolylineEncoder<Digits>::toE5(Element &&element,
+                                                                        GetLat &getLat, GetLon &getLon)
+{
+    static_assert(std::is_convertible<decltype(get(getLat, element)), double>::value,
+                  "The latitude accessor must return a number");
+    static_assert(std::is_convertible<decltype(get(getLon, element)), double>::value,
+                  "The longitude accessor must return a number");
+
+    return PointE5{ toE5(get(getLat, element)), toE5(get(getLon, element)) };
+}
+
+template<int Digits>
+template<typename InputIt>
+size_t PolylineEncoder<Digits>::rangeSize(InputIt, InputIt, std::input_iterator_tag)
+{
+    return 0;
+}
+
+template<int Digits>
+template<typename InputIt>
+size_t PolylineEncoder<Digits>::rangeSize(InputIt first, InputIt last, std::forward_iterator_tag)
+{
+    return static_cast<size_t>(std::distance(first, last));
+}
+
+template<int Digits>
+std::string PolylineEncoder<Digits>::encode(const typename PolylineEncoder::Polyline &polyline)
+{
+    return encode(polyline.cbegin(), polyline.cend(), &Point::latitude, &Point::longitude);
+}
+
+template<int Digits>
+template<typename Allocator>
+void PolylineEncoder<Digits>::encode(const typename PolylineEncoder::Polyline &polyline,
+                                     BasicString<Allocator> &result)
+{
+    encode(polyline.cbegin(), polyline.cend(), &Point::latitude, &Point::longitude, result);
+}
+
+template<int Digits>
+template<typename OutputIt>
+OutputIt PolylineEncoder<Digits>::encode(const typename PolylineEncoder::Polyline &polyline,
+                                         OutputIt out)
+{
+    return encode(polyline.cbegin(), polyline.cend(), &Point::latitude, &Point::longitude, out);
+}
+
+template<int Digits>
+size_t PolylineEncoder<Digits>::encodedSize(const Polyline &polyline)
+{
+    size_t size = 0;
+    PointE5 previous{ 0, 0 };
+    for (const auto &point : polyline) {
+        const PointE5 current{ toE5(point.latitude()), toE5(point.longitude()) };
+        size += valueSize(zigzag(static_cast<int32_t>(static_cast<uint32_t>(current.latitude) -
+                                                      static_cast<uint32_t>(previous.latitude))));
+        size += valueSize(zigzag(static_cast<int32_t>(static_cast<uint32_t>(current.longitude) -
+                                                      static_cast<uint32_t>(previous.longitude))));
+        previous = current;
+    }
+    return size;
+}
+
+template<int Digits>
+std::string PolylineEncoder<Digits>::encodeE5(const PolylineE5 &polyline)
+{
+    std::string result;
+    encodeE5(polyline, result);
+    return result;
+}
+
+template<int Digits>
+template<typename Allocator>
+void PolylineEncoder<Digits>::encodeE5(const PolylineE5 &polyline, BasicString<Allocator> &result)
+{
+#ifdef POLYLINEENCODER_ENABLE_STATS
+    PolylineStats::Scope scope(PolylineStats::Operation::Encode);
+#endif
+
+    const auto offset = result.size();
+    result.resize(offset + maxEncodedSize(polyline.size()));
+
+    PointE5 previous{ 0, 0 };
+    result.resize(encodeInto(result, offset, polyline.data(), polyline.size(), previous));
+}
+
+template<int Digits>
+template<typename OutputIt>
+OutputIt PolylineEncoder<Digits>::encodeE5(const PolylineE5 &polyline, OutputIt out)
+{
+    PointE5 previous{ 0, 0 };
+    for (const auto &point : polyline) {
+        out = encode(point, previous, out);
+    }
+    return out;
+}
+
+template<int Digits>
+int PolylineEncoder<Digits>::lowestByte(uint64_t word)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(word) / 8;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index = 0;
+    _BitScanForward64(&index, word);
+    return static_cast<int>(index / 8);
+#else
+    // Count the bytes below the lowest set bit.
+    const uint64_t below = (word & (0 - word)) - 1;
+    return static_cast<int>((((below >> 7) & 0x0101010101010101ULL) * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+template<int Digits>
+int32_t PolylineEncoder<Digits>::decodeChunks(uint64_t word)
+{
+    // Join the 5-bit chunks: first into 10-bit, then 20-bit and finally 40-bit groups (7).
+    word = (word & 0x001f001f001f001fULL) | ((word & 0x1f001f001f001f00ULL) >> 3);
+    word = (word & 0x000003ff000003ffULL) | ((word & 0x03ff000003ff0000ULL) >> 6);
+    const auto result = static_cast<uint32_t>((word & 0xfffffULL) | ((word >> 32) << 20));
+
+    // Odd values are negative ones with inverted bits (5), restore them
+    // with the arithmetic shift right (4).
+    return static_cast<int32_t>((result >> 1) ^ (0 - (result & 1)));
+}
+
+template<int Digits>
+bool PolylineEncoder<Digits>::decodeWord(const char *&it, int32_t &latitude, int32_t &longitude)
+{
+    uint64_t word = 0;
+    std::memcpy(&word, it, sizeof(word));
+
+    const uint64_t high = 0x8080808080808080ULL;
+    const uint64_t low = word & 0x7f7f7f7f7f7f7f7fULL;
+
+    // The high bits mark the characters within ['?', '~'] range (63 - 126) and
+    // the characters without the continuation bit, i.e. less than '_' (95).
+    const uint64_t valid = ~word & (low + 0x4141414141414141ULL) & ~(low + 0x0101010101010101ULL) & high;
+    const uint64_t last = ~(low + 0x2121212121212121ULL) & high;
+
+    // The first two characters that terminate the values or are invalid.
+    const uint64_t stop = last | (~valid & high);
+    const uint64_t first = stop & (0 - stop);
+    const uint64_t rest = stop & ~first;
+    const uint64_t second = rest & (0 - rest);
+    if (second == 0 || ((first | second) & ~valid)) {
+        return false;
+    }
+
+    const int latitudeSize = lowestByte(first) + 1;
+    const int size = lowestByte(second) + 1;
+    if (latitudeSize == s_maxChunks || size - latitudeSize == s_maxChunks) {
+        // The longest values may overflow 32 bits, let the regular decoding check them.
+        return false;
+    }
+
+    // Subtract the offset (10), no borrows cross the bytes of the values.
+    const uint64_t chunks = (word - 0x3f3f3f3f3f3f3f3fULL) & 0x1f1f1f1f1f1f1f1fULL;
+
+    latitude = decodeChunks(chunks & (first - 1));
+    longitude = decodeChunks((chunks & (second - 1)) >> (8 * latitudeSize));
+    it += size;
+    return true;
+}
+
+template<int Digits>
+POLYLINEENCODER_CONSTEXPR typename PolylineEncoder<Digits>::Status
+PolylineEncoder<Digits>::decode(const char *&it, const char *end, int32_t &value)
+{
+    const char *start = it;
+    uint32_t result = 0;
+    int shift = 0;
+    uint32_t c = 0;
+    do {
+        if (it == end) {
+            it = start;
+            return Status::Incomplete;
+        }
+        // Characters below the offset wrap around to large values.
+        c = static_cast<unsigned char>(*it) - static_cast<uint32_t>(s_asciiOffset); // (10)
+        if (c > s_5bitMask + s_6bitMask) {
+            return Status::InvalidCharacter;
+        }
+        if (shift == 30 && c > 3) {
+            // Only two bits of the last chunk fit into 32 bits, and no more chunks may follow.
+            return Status::Overflow;
+        }
+        result |= (c & s_5bitMask) << shift;
+        shift += s_chunkSize;                // (7)
+        ++it;
+    } while (c >= s_6bitMask);
+
+    // Odd values are negative ones with inverted bits (5), restore them
+    // with the arithmetic shift right (4).
+    value = static_cast<int32_t>((result >> 1) ^ (0 - (result & 1)));
+    return Status::Ok;
+}
+
+template<int Digits>
+typename PolylineEncoder<Digits>::Status
+PolylineEncoder<Digits>::decodePoint(const char *&it, const char *end, int32_t &latDelta, int32_t &lonDelta)
+{
+#ifdef POLYLINEENCODER_LITTLE_ENDIAN
+    // Most points fit into 8 characters and are decoded at once.
+    if (end - it >= static_cast<ptrdiff_t>(sizeof(uint64_t)) && decodeWord(it, latDelta, lonDelta)) {
+        return Status::Ok;
+    }
+#endif
+
+    const Status status = decode(it, end, latDelta);
+    if (status != Status::Ok) {
+        return status;
+    }
+    return decode(it, end, lonDelta);
+}
+
+template<int Digits>
+POLYLINEENCODER_CONSTEXPR bool PolylineEncoder<Digits>::isValid(uint32_t latitude, uint32_t longitude)
+{
+    // Shift the ranges to start at zero, so that each check takes one comparison.
+    const auto lat = static_cast<int64_t>(static_cast<int32_t>(latitude)) + s_maxLatitude;
+    const auto lon = static_cast<int64_t>(static_cast<int32_t>(longitude)) + s_maxLongitude;
+    return (static_cast<uint64_t>(lat) <= static_cast<uint64_t>(2 * s_maxLatitude)) &
+           (static_cast<uint64_t>(lon) <= static_cast<uint64_t>(2 * s_maxLongitude));
+}
+
+template<int Digits>
+template<typename Emit>
+typename PolylineEncoder<Digits>::Result
+PolylineEncoder<Digits>::decodePoints(const char *first, const char *last, Emit &&emit)
+{
+#ifdef POLYLINEENCODER_ENABLE_STATS
+    PolylineStats::Scope scope(PolylineStats::Operation::Decode);
+#endif
+
+    const char *it = first;
+    uint32_t lat = 0;
+    uint32_t lon = 0;
+    Result result{ Status::Ok, static_cast<size_t>(last - first), 0 };
+
+    while (it != last) {
+        const char *point = it;
+        int32_t latDelta = 0;
+        int32_t lonDelta = 0;
+        const Status status = decodePoint(it, last, latDelta, lonDelta);
+        if (status != Status::Ok) {
+            result.status = status;
+            result.position = static_cast<size_t>(it - first);
+            break;
+        }
+
+        // Accumulate in modular arithmetic as the encoder computes the offsets.
+        lat += static_cast<uint32_t>(latDelta);
+        lon += static_cast<uint32_t>(lonDelta);
+        if (!isValid(lat, lon)) {
+            result.status = Status::OutOfRange;
+            result.position = static_cast<size_t>(point - first);
+            break;
+        }
+
+        emit(static_cast<int32_t>(lat), static_cast<int32_t>(lon));
+        ++result.pointCount;
+    }
+
+#ifdef POLYLINEENCODER_ENABLE_STATS
+    PolylineStats::decoded(result.pointCount, result.position, static_cast<int>(result.status));
+#endif
+
+    return result;
+}
+
+template<int Digits>
+typename PolylineEncoder<Digits>::Polyline PolylineEncoder<Digits>::decode(const std::string &coords)
+{
+    Polyline polyline;
+
+    const char *data = coords.data();
+    if (!decodePoints(data, data + coords.size(), [&polyline](int32_t lat, int32_t lon) {
+            polyline.push_back(Point::fromE5(lat, lon));
+        })) {
+        polyline.clear();
+    }
+
+    return polyline;
+}
+
+template<int Digits>
+template<typename Allocator>
+typename PolylineEncoder<Digits>::Result
+PolylineEncoder<Digits>::decode(const std::string &coords, std::vector<Point, Allocator> &polyline)
+{
+    return decode(coords.data(), coords.size(), polyline);
+}
+
+template<int Digits>
+template<typename Allocator>
+typename PolylineEncoder<Digits>::Result
+PolylineEncoder<Digits>::decode(const char *data, size_t size, std::vector<Point, Allocator> &polyline)
+{
+    return decodePoints(data, data + size, [&polyline](int32_t lat, int32_t lon) {
+        polyline.push_back(Point::fromE5(lat, lon));
+    });
+}
+
+template<int Digits>
+typename PolylineEncoder<Digits>::Result PolylineEncoder<Digits>::validate(const char *data, size_t size)
+{
+    return decodePoints(data, data + size, [](int32_t, int32_t) {});
+}
+
+template<int Digits>
+typename PolylineEncoder<Digits>::Result PolylineEncoder<Digits>::validate(const std::string &coords)
+{
+    return validate(coords.data(), coords.size());
+}
+
+template<int Digits>
+typename PolylineEncoder<Digits>::PolylineE5 PolylineEncoder<Digits>::decodeE5(const std::string &coords)
+{
+    PolylineE5 polyline;
+
+    const char *data = coords.data();
+    if (!decodePoints(data, data + coords.size(), [&polyline](int32_t lat, int32_t lon) {
+            polyline.push_back(PointE5{ lat, lon });
+        })) {
+        polyline.clear();
+    }
+
+    return polyline;
+}
+
+template<int Digits>
+template<typename Allocator>
+typename PolylineEncoder<Digits>::Result
+PolylineEncoder<Digits>::decodeE5(const std::string &coords, std::vector<PointE5, Allocator> &polyline)
+{
+    return decodeE5(coords.data(), coords.size(), polyline);
+}
+
+template<int Digits>
+template<typename Allocator>
+typename PolylineEncoder<Digits>::Result
+PolylineEncoder<Digits>::decodeE5(const char *data, size_t size, std::vector<PointE5, Allocator> &polyline)
+{
+    return decodePoints(data, data + size, [&polyline](int32_t lat, int32_t lon) {
+        polyline.push_back(PointE5{ lat, lon });
+    });
+}
+
+#ifdef POLYLINEENCODER_CXX17
+template<int Digits>
+constexpr int32_t PolylineEncoder<Digits>::roundE5(double degrees)
+{
+    // std::round() is not constexpr. Round half away from zero by the fractional part,
+    // which is computed exactly.
+    const double value = degrees * Precision::Value;
+    const auto whole = static_cast<int64_t>(value);
+    const double fraction = value - static_cast<double>(whole);
+    return static_cast<int32_t>(whole + (fraction >= 0.5) - (fraction <= -0.5)); // (2)
+}
+
+template<int Digits>
+template<size_t Count>
+constexpr auto PolylineEncoder<Digits>::encodeFixed(const double (&points)[Count][2])
+{
+    PointE5 pointsE5[Count]{};
+    for (size_t i = 0; i < Count; ++i) {
+        pointsE5[i] = PointE5{ roundE5(points[i][0]), roundE5(points[i][1]) };
+    }
+    return encodeFixedE5(pointsE5);
+}
+
+template<int Digits>
+template<size_t Count>
+constexpr auto PolylineEncoder<Digits>::encodeFixedE5(const PointE5 (&points)[Count])
+{
+    FixedString<maxEncodedSize(Count)> result{};
+
+    PointE5 previous{ 0, 0 };
+    char *out = result.data;
+    for (const auto &point : points) {
+        if (!isValid(static_cast<uint32_t>(point.latitude), static_cast<uint32_t>(point.longitude))) {
+            // The encoded point might not fit into the string.
+            return FixedString<maxEncodedSize(Count)>{};
+        }
+        out = encode(point, previous, out);
+    }
+    result.size = static_cast<size_t>(out - result.data);
+    return result;
+}
+
+template<int Digits>
+template<size_t Capacity>
+constexpr typename PolylineEncoder<Digits>::template FixedPolyline<Capacity>
+PolylineEncoder<Digits>::decodeFixed(std::string_view coords)
+{
+    FixedPolyline<Capacity> polyline{};
+
+    const char *first = coords.data();
+    const char *last = first + coords.size();
+    const char *it = first;
+    uint32_t lat = 0;
+    uint32_t lon = 0;
+    size_t count = 0;
+
+    while (it != last) {
+        const char *point = it;
+        if (count == Capacity) {
+            polyline.result = Result{ Status::Overflow, static_cast<size_t>(point - first), count };
+            return polyline;
+        }
+
+        int32_t latDelta = 0;
+        int32_t lonDelta = 0;
+        Status status = decode(it, last, latDelta);
+        if (status == Status::Ok) {
+            status = decode(it, last, lonDelta);
+        }
+        if (status != Status::Ok) {
+            polyline.result = Result{ status, static_cast<size_t>(it - first), count };
+            return polyline;
+        }
+
+        lat += static_cast<uint32_t>(latDelta);
+        lon += static_cast<uint32_t>(lonDelta);
+        if (!isValid(lat, lon)) {
+            polyline.result = Result{ Status::OutOfRange, static_cast<size_t>(point - first), count };
+            return polyline;
+        }
+        polyline.points[count++] = PointE5{ static_cast<int32_t>(lat), static_cast<int32_t>(lon) };
+    }
+
+    polyline.result = Result{ Status::Ok, coords.size(), count };
+    return polyline;
+}
+#endif
+
+template<int Digits>
+std::string PolylineEncoder<Digits>::encodeColumns(const double *latitudes, const double *longitudes,
+                                                   size_t count)
+{
+    std::string result;
+    encodeColumns(latitudes, longitudes, count, result);
+    return result;
+}
+
+template<int Digits>
+template<typename Allocator>
+void PolylineEncoder<Digits>::encodeColumns(const double *latitudes, const double *longitudes,
+                                            size_t count, BasicString<Allocator> &result)
+{
+    encodeIndexed(count, [latitudes, longitudes](size_t i) {
+        return PointE5{ toE5(latitudes[i]), toE5(longitudes[i]) };
+    }, result);
+}
+
+template<int Digits>
+std::string PolylineEncoder<Digits>::encodeColumnsE5(const int32_t *latitudes, const int32_t *longitudes,
+                                                     size_t count)
+{
+    std::string result;
+    encodeColumnsE5(latitudes, longitudes, count, result);
+    return result;
+}
+
+template<int Digits>
+template<typename Allocator>
+void PolylineEncoder<Digits>::encodeColumnsE5(const int32_t *latitudes, const int32_t *longitudes,
+                                              size_t count, BasicString<Allocator> &result)
+{
+    encodeIndexed(count, [latitudes, longitudes](size_t i) {
+        return PointE5{ latitudes[i], longitudes[i] };
+    }, result);
+}
+
+template<int Digits>
+typename PolylineEncoder<Digits>::Result PolylineEncoder<Digits>::bbox(const std::string &coords,
+                                                                       BoundingBox &box)
+{
+    PointE5 min{ std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max() };
+    PointE5 max{ std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min() };
+
+    const char *data = coords.data();
+    const auto result = decodePoints(data, data + coords.size(), [&min, &max](int32_t lat, int32_t lon) {
+        min.latitude = std::min(min.latitude, lat);
+        min.longitude = std::min(min.longitude, lon);
+        max.latitude = std::max(max.latitude, lat);
+        max.longitude = std::max(max.longitude, lon);
+    });
+
+    box = result.pointCount > 0 ? BoundingBox{ min, max } : BoundingBox{ { 0, 0 }, { 0, 0 } };
+    return result;
+}
+
+template<int Digits>
+size_t PolylineEncoder<Digits>::pointCount(const std::string &coords)
+{
+    return countPoints(coords.data(), coords.size());
+}
+
+template<int Digits>
+typename PolylineEncoder<Digits>::Result PolylineEncoder<Digits>::lengthMeters(const std::string &coords,
+                                                                               double &meters)
+{
+    const double toRadians = 3.14159265358979323846 / 180.0 / Precision::Value;
+
+    double length = 0.0;
+    double previousLat = 0.0;
+    double previousLon = 0.0;
+    double previousCos = 0.0;
+    bool first = true;
+
+    const char *data = coords.data();
+    const auto result = decodePoints(data, data + coords.size(), [&](int32_t lat, int32_t lon) {
+        const double latitude = lat * toRadians;
+        const double longitude = lon * toRadians;
+        const double cosine = std::cos(latitude);
+        if (!first) {
+            // The cosine of each latitude is computed once for both its segments.
+            const double sinLat = std::sin((latitude - previousLat) / 2);
+            const double sinLon = std::sin((longitude - previousLon) / 2);
+            const double a = sinLat * sinLat + previousCos * cosine * sinLon * sinLon;
+            length += 2 * std::asin(std::min(1.0, std::sqrt(a)));
+        }
+        previousLat = latitude;
+        previousLon = longitude;
+        previousCos = cosine;
+        first = false;
+    });
+
+    meters = length * s_earthRadius;
+    return result;
+}
+
+template<int Digits>
+typename PolylineEncoder<Digits>::Result PolylineEncoder<Digits>::firstLast(const std::string &coords,
+                                                                            PointE5 &first, PointE5 &last)
+{
+    first = PointE5{ 0, 0 };
+    last = PointE5{ 0, 0 };
+    bool hasFirst = false;
+
+    const char *data = coords.data();
+    return decodePoints(data, data + coords.size(), [&](int32_t lat, int32_t lon) {
+        if (!hasFirst) {
+            first = PointE5{ lat, lon };
+            hasFirst = true;
+        }
+        last = PointE5{ lat, lon };
+    });
+}
+
+template<int Digits>
+bool PolylineEncoder<Digits>::advance(const char *&it, const char *end, size_t &count, PointE5 &point)
+{
+    auto lat = static_cast<uint32_t>(point.latitude);
+    auto lon = static_cast<uint32_t>(point.longitude);
+
+    for (; count > 0 && it != end; --count) {
+        int32_t latDelta = 0;
+        int32_t lonDelta = 0;
+        if (decodePoint(it, end, latDelta, lonDelta) != Status::Ok) {
+            return false;
+        }
+        lat += static_cast<uint32_t>(latDelta);
+        lon += static_cast<uint32_t>(lonDelta);
+        if (!isValid(lat, lon)) {
+            return false;
+        }
+    }
+
+    point = PointE5{ static_cast<int32_t>(lat), static_cast<int32_t>(lon) };
+    return true;
+}
+
+template<int Digits>
+bool PolylineEncoder<Digits>::rebase(const char *first, const char *last, const PointE5 &origin,
+                                     const PointE5 &previous, std::string &result)
+{
+    if (first == last) {
+        return true;
+    }
+
+    size_t count = 1;
+    PointE5 point = origin;
+    if (!advance(first, last, count, point)) {
+        return false;
+    }
+
+    // The copied points keep their absolute coordinates, they are scanned
+    // from the first one without creating any points.
+    const char *rest = first;
+    PointE5 current = point;
+    count = std::numeric_limits<size_t>::max();
+    if (!advance(rest, last, count, current)) {
+        return false;
+    }
+
+    current = previous;
+    encode(point, current, std::back_inserter(result));
+    result.append(first, last);
+    return true;
+}
+
+template<int Digits>
+std::string PolylineEncoder<Digits>::concat(const std::string &first, const std::string &second)
+{
+    const char *it = first.data();
+    const char *end = it + first.size();
+    size_t count = std::numeric_limits<size_t>::max();
+    PointE5 last{ 0, 0 };
+    if (!advance(it, end, count, last)) {
+        return std::string();
+    }
+
+    std::string result;
+    result.reserve(first.size() + second.size() + 2 * s_maxChunks);
+    result.append(first);
+    if (!rebase(second.data(), second.data() + second.size(), PointE5{ 0, 0 }, last, result)) {
+        return std::string();
+    }
+    return result;
+}
+
+template<int Digits>
+std::string PolylineEncoder<Digits>::slice(const std::string &coords, size_t begin, size_t end)
+{
+    const char *it = coords.data();
+    const char *last = it + coords.size();
+    size_t count = begin;
+    PointE5 origin{ 0, 0 };
+    if (begin >= end || !advance(it, last, count, origin) || count != 0) {
+        return std::string();
+    }
+
+    // Find the end of the range by the characters without the continuation bit,
+    // two per point.
+    const char *sliceEnd = it;
+    for (size_t values = 2 * (end - begin); sliceEnd != last && values > 0; ++sliceEnd) {
+        values -= static_cast<unsigned char>(*sliceEnd) - s_asciiOffset < s_6bitMask;
+    }
+
+    std::string result;
+    result.reserve(static_cast<size_t>(sliceEnd - it) + 2 * s_maxChunks);
+    if (!rebase(it, sliceEnd, origin, PointE5{ 0, 0 }, result)) {
+        return std::string();
+    }
+    return result;
+}
+
+template<int Digits>
+std::string PolylineEncoder<Digits>::splice(const std::string &coords, size_t begin, size_t end,
+                                            const std::string &insert)
+{
+    const char *it = coords.data();
+    const char *last = it + coords.size();
+
+    // The points before the range are kept as they are.
+    size_t count = begin;
+    PointE5 previous{ 0, 0 };
+    if (!advance(it, last, count, previous)) {
+        return std::string();
+    }
+    const char *rangeBegin = it;
+
+    // The removed points are decoded to find the origin of the rest.
+    count = end > begin ? end - begin : 0;
+    PointE5 origin = previous;
+    if (!advance(it, last, count, origin)) {
+        return std::string();
+    }
+
+    // The inserted polyline is scanned for its last point.
+    const char *insertIt = insert.data();
+    const char *insertEnd = insertIt + insert.size();
+    count = std::numeric_limits<size_t>::max();
+    PointE5 insertLast{ 0, 0 };
+    if (!advance(insertIt, insertEnd, count, insertLast)) {
+        return std::string();
+    }
+
+    std::string result;
+    result.reserve(coords.size() + insert.size() + 4 * s_maxChunks);
+    result.append(coords.data(), rangeBegin);
+    if (!insert.empty()) {
+        rebase(insert.data(), insertEnd, PointE5{ 0, 0 }, previous, result);
+        previous = insertLast;
+    }
+    if (!rebase(it, last, origin, previous, result)) {
+        return std::string();
+    }
+    return result;
+}
+
+template<int Digits>
+std::string PolylineEncoder<Digits>::encodeSimplified(const Polyline &polyline, double tolerance)
+{
+    std::string result;
+    encodeSimplified(polyline, tolerance, result);
+    return result;
+}
+
+template<int Digits>
+template<typename Allocator>
+void PolylineEncoder<Digits>::encodeSimplified(const Polyline &polyline, double tolerance,
+                                               BasicString<Allocator> &result)
+{
+    // The points are quantized once, the simplification visits them many times.
+    PolylineE5 points;
+    points.reserve(polyline.size());
+    for (const auto &point : polyline) {
+        points.push_back(PointE5{ toE5(point.latitude()), toE5(point.longitude()) });
+    }
+    encodeSimplifiedE5(points, tolerance, result);
+}
+
+template<int Digits>
+std::string PolylineEncoder<Digits>::encodeSimplifiedE5(const PolylineE5 &polyline, double tolerance)
+{
+    std::string result;
+    encodeSimplifiedE5(polyline, tolerance, result);
+    return result;
+}
+
+template<int Digits>
+template<typename Allocator>
+void PolylineEncoder<Digits>::encodeSimplifiedE5(const PolylineE5 &polyline, double tolerance,
+                                                 BasicString<Allocator> &result)
+{
+    const PointE5 *points = polyline.data();
+    const auto indices = simplify(points, polyline.size(), tolerance * Precision::Value);
+    encodeIndexed(indices.size(), [points, &indices](size_t i) {
+        return points[indices[i]];
+    }, result);
+}
+
+template<int Digits>
+typename PolylineEncoder<Digits>::Columns PolylineEncoder<Digits>::decodeColumns(const std::string &coords)
+{
+    Columns columns;
+    const size_t count = countPoints(coords.data(), coords.size());
+    columns.latitudes.reserve(count);
+    columns.longitudes.reserve(count);
+
+    const char *data = coords.data();
+    if (!decodePoints(data, data + coords.size(), [&columns](int32_t lat, int32_t lon) {
+            columns.latitudes.push_back(fromE5(lat));
+            columns.longitudes.push_back(fromE5(lon));
+        })) {
+        columns.latitudes.clear();
+        columns.longitudes.clear();
+    }
+
+    return columns;
+}
+
+template<int Digits>
+typename PolylineEncoder<Digits>::ColumnsE5 PolylineEncoder<Digits>::decodeColumnsE5(const std::string &coords)
+{
+    ColumnsE5 columns;
+    const size_t count = countPoints(coords.data(), coords.size());
+    columns.latitudes.reserve(count);
+    columns.longitudes.reserve(count);
+
+    const char *data = coords.data();
+    if (!decodePoints(data, data + coords.size(), [&columns](int32_t lat, int32_t lon) {
+            columns.latitudes.push_back(lat);
+            columns.longitudes.push_back(lon);
+        })) {
+        columns.latitudes.clear();
+        columns.longitudes.clear();
+    }
+
+    return columns;
+}
+
+template<int Digits>
+const typename PolylineEncoder<Digits>::Polyline &PolylineEncoder<Digits>::polyline() const
+{
+    return m_polyline;
+}
+
+template<int Digits>
+size_t PolylineEncoder<Digits>::pointCount() const
+{
+    return m_pointCount;
+}
+
+template<int Digits>
+void PolylineEncoder<Digits>::clear()
+{
+    m_polyline.clear();
+    m_encoded.clear();
+    m_previous = PointE5{ 0, 0 };
+    m_pointCount = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PolylineDecoder implementation
+///////////////////////////////////////////////////////////////////////////////
+template<int Digits>
+template<typename Emit>
+bool PolylineDecoder<Digits>::decode(const char *data, size_t size, Emit &&emit)
+{
+    return decodeE5(data, size, [&emit](const PointE5 &point) {
+        emit(Point::fromE5(point.latitude, point.longitude));
+    });
+}
+
+template<int Digits>
+template<typename Emit>
+bool PolylineDecoder<Digits>::decode(const std::string &chunk, Emit &&emit)
+{
+    return decode(chunk.data(), chunk.size(), std::forward<Emit>(emit));
+}
+
+template<int Digits>
+template<typename Emit>
+bool PolylineDecoder<Digits>::decodeE5(const char *data, size_t size, Emit &&emit)
+{
+    const char *it = data;
+    const char *end = data + size;
+
+    while (!m_failed && it != end) {
+#ifdef POLYLINEENCODER_LITTLE_ENDIAN
+        // Decode whole points at once while there is no partial state.
+        int32_t latDelta = 0;
+        int32_t lonDelta = 0;
+        if (m_shift == 0 && !m_hasLatitude && end - it >= static_cast<ptrdiff_t>(sizeof(uint64_t)) &&
+            Encoder::decodeWord(it, latDelta, lonDelta)) {
+            m_failed = !push(latDelta, emit) || !push(lonDelta, emit);
+            continue;
+        }
+#endif
+
+        const uint32_t c = static_cast<unsigned char>(*it++) - static_cast<uint32_t>(Encoder::s_asciiOffset); // (10)
+        if (c > Encoder::s_5bitMask + Encoder::s_6bitMask || (m_shift == 30 && c > 3)) {
+            // Invalid character or the value does not fit into 32 bits.
+            m_failed = true;
+            break;
+        }
+        m_value |= (c & Encoder::s_5bitMask) << m_shift;
+        m_shift += Encoder::s_chunkSize;                 // (7)
+
+        if (c >= Encoder::s_6bitMask) {
+            continue;
+        }
+
+        // Odd values are negative ones with inverted bits (5), (4).
+        const auto value = static_cast<int32_t>((m_value >> 1) ^ (0 - (m_value & 1)));
+        m_value = 0;
+        m_shift = 0;
+        m_failed = !push(value, emit);
+    }
+
+    return !m_failed;
+}
+
+template<int Digits>
+template<typename Emit>
+bool PolylineDecoder<Digits>::push(int32_t value, Emit &emit)
+{
+    if (!m_hasLatitude) {
+        m_latitudeDelta = value;
+        m_hasLatitude = true;
+        return true;
+    }
+
+    const uint32_t latitude = m_latitude + static_cast<uint32_t>(m_latitudeDelta);
+    const uint32_t longitude = m_longitude + static_cast<uint32_t>(value);
+    if (!Encoder::isValid(latitude, longitude)) {
+        // Invalid coordinates, imply invalid polyline string.
+        return false;
+    }
+
+    m_latitude = latitude;
+    m_longitude = longitude;
+    m_hasLatitude = false;
+    ++m_pointCount;
+
+    emit(PointE5{ static_cast<int32_t>(m_latitude), static_cast<int32_t>(m_longitude) });
+    return true;
+}
+
+template<int Digits>
+bool PolylineDecoder<Digits>::isComplete() const
+{
+    return !m_failed && m_shift == 0 && !m_hasLatitude;
+}
+
+template<int Digits>
+bool PolylineDecoder<Digits>::hasFailed() const
+{
+    return m_failed;
+}
+
+template<int Digits>
+size_t PolylineDecoder<Digits>::pointCount() const
+{
+    return m_pointCount;
+}
+
+template<int Digits>
+void PolylineDecoder<Digits>::reset()
+{
+    *this = PolylineDecoder();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PolylineView implementation
+///////////////////////////////////////////////////////////////////////////////
+template<int Digits>
+PolylineView<Digits>::Iterator::Iterator(const char *data, const char *end)
+    : m_it(data)
+    , m_end(end)
+    , m_atEnd(false)
+{
+    advance();
+}
+
+template<int Digits>
+typename PolylineView<Digits>::Iterator::reference PolylineView<Digits>::Iterator::operator*() const
+{
+    assert(!m_atEnd);
+    return m_point;
+}
+
+template<int Digits>
+typename PolylineView<Digits>::Iterator::pointer PolylineView<Digits>::Iterator::operator->() const
+{
+    assert(!m_atEnd);
+    return Pointer(m_point);
+}
+
+template<int Digits>
+typename PolylineView<Digits>::PointE5 PolylineView<Digits>::Iterator::e5() const
+{
+    assert(!m_atEnd);
+    return PointE5{ static_cast<int32_t>(m_latitude), static_cast<int32_t>(m_longitude) };
+}
+
+template<int Digits>
+typename PolylineView<Digits>::Iterator &PolylineView<Digits>::Iterator::operator++()
+{
+    advance();
+    return *this;
+}
+
+template<int Digits>
+typename PolylineView<Digits>::Iterator PolylineView<Digits>::Iterator::operator++(int)
+{
+    Iterator tmp = *this;
+    advance();
+    return tmp;
+}
+
+template<int Digits>
+bool PolylineView<Digits>::Iterator::operator==(const Iterator &other) const
+{
+    return m_atEnd == other.m_atEnd && (m_atEnd || m_it == other.m_it);
+}
+
+template<int Digits>
+bool PolylineView<Digits>::Iterator::operator!=(const Iterator &other) const
+{
+    return !(*this == other);
+}
+
+template<int Digits>
+void PolylineView<Digits>::Iterator::advance()
+{
+    int32_t latDelta = 0;
+    int32_t lonDelta = 0;
+    if (m_atEnd || m_it == m_end ||
+        Encoder::decodePoint(m_it, m_end, latDelta, lonDelta) != Encoder::Status::Ok ||
+        !Encoder::isValid(m_latitude + static_cast<uint32_t>(latDelta),
+                          m_longitude + static_cast<uint32_t>(lonDelta))) {
+        m_atEnd = true;
+        return;
+    }
+
+    m_latitude += static_cast<uint32_t>(latDelta);
+    m_longitude += static_cast<uint32_t>(lonDelta);
+    m_point = Point::fromE5(static_cast<int32_t>(m_latitude), static_cast<int32_t>(m_longitude));
+}
+
+template<int Digits>
+PolylineView<Digits>::PolylineView(const char *data, size_t size)
+    : m_data(data)
+    , m_size(size)
+{}
+
+template<int Digits>
+PolylineView<Digits>::PolylineView(const std::string &coords)
+    : m_data(coords.data())
+    , m_size(coords.size())
+{}
+
+#ifdef POLYLINEENCODER_CXX17
+template<int Digits>
+PolylineView<Digits>::PolylineView(std::string_view coords)
+    : m_data(coords.data())
+    , m_size(coords.size())
+{}
+#endif
+
+template<int Digits>
+typename PolylineView<Digits>::Iterator PolylineView<Digits>::begin() const
+{
+    return Iterator(m_data, m_data + m_size);
+}
+
+template<int Digits>
+typename PolylineView<Digits>::Iterator PolylineView<Digits>::end() const
+{
+    return Iterator();
+}
+
+template<int Digits>
+bool PolylineView<Digits>::empty() const
+{
+    return m_size == 0;
+}
+
+template<int Digits>
+size_t PolylineView<Digits>::count() const
+{
+    return Encoder::countPoints(m_data, m_size);
+}
+
+template<int Digits>
+typename PolylineView<Digits>::Point PolylineView<Digits>::front() const
+{
+    assert(!empty());
+    return *begin();
+}
+
+template<int Digits>
+typename PolylineView<Digits>::Point PolylineView<Digits>::back() const
+{
+    assert(!empty());
+
+    const char *it = m_data;
+    const char *end = m_data + m_size;
+    uint32_t lat = 0;
+    uint32_t lon = 0;
+    int32_t latDelta = 0;
+    int32_t lonDelta = 0;
+    while (it != end && Encoder::decodePoint(it, end, latDelta, lonDelta) == Encoder::Status::Ok &&
+           Encoder::isValid(lat + static_cast<uint32_t>(latDelta), lon + static_cast<uint32_t>(lonDelta))) {
+        lat += static_cast<uint32_t>(latDelta);
+        lon += static_cast<uint32_t>(lonDelta);
+    }
+    return Point::fromE5(static_cast<int32_t>(lat), static_cast<int32_t>(lon));
+}
+
+template<int Digits>
+const char *PolylineView<Digits>::data() const
+{
+    return m_data;
+}
+
+template<int Digits>
+size_t PolylineView<Digits>::size() const
+{
+    return m_size;
 }
 
 } // namespace
@@ -0,0 +1,534 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2017 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef POLYLINEFILE_H
+#define POLYLINEFILE_H
+
+#include "polylineencoder.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   ifndef WIN32_LEAN_AND_MEAN
+#       define WIN32_LEAN_AND_MEAN
+#   endif
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+namespace gepaf
+{
+
+//! A read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    //! Unmaps the file.
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    //! Maps the file at the given \p path, unmapping the previous one.
+    /*!
+        \returns false if the file cannot be opened or mapped.
+    */
+    bool open(const std::string &path);
+
+    //! Unmaps the file.
+    void close();
+
+    //! Returns true if a file is mapped, even an empty one.
+    bool isOpen() const;
+
+    //! Returns the contents of the file, nullptr for empty files.
+    const char *data() const;
+
+    //! Returns the size of the file in bytes.
+    size_t size() const;
+
+private:
+    const char *m_data{ nullptr };
+    size_t m_size{ 0 };
+    bool m_open{ false };
+};
+
+//! Reads newline-delimited encoded polylines.
+/*!
+    Each line of the input is one encoded polyline, "\r\n" line endings are accepted
+    too. Empty lines are empty polylines. The records are not copied: the file is
+    memory-mapped and the records are views into it, while the decoded points are
+    written to the containers that the caller reuses from record to record.
+*/
+template<int Digits = 5>
+class PolylineReader
+{
+public:
+    using Encoder    = PolylineEncoder<Digits>;
+    using Polyline   = typename Encoder::Polyline;
+    using PolylineE5 = typename Encoder::PolylineE5;
+    using Result     = typename Encoder::Result;
+
+    //! Creates a reader without input.
+    PolylineReader() = default;
+
+    //! Creates a reader of the \p size characters of \p data, which must outlive the reader.
+    PolylineReader(const char *data, size_t size);
+
+    //! Maps the file at the given \p path for reading.
+    /*!
+        \returns false if the file cannot be opened.
+    */
+    bool open(const std::string &path);
+
+    //! Returns true if there is input to read, which may be empty.
+    bool isOpen() const;
+
+    //! Reads the next record without copying and decoding it.
+    /*!
+        \returns false if there are no more records.
+    */
+    bool next(PolylineView<Digits> &record);
+
+    //! Decodes the next record into the \p points, which are cleared but keep their capacity.
+    /*!
+        Invalid records are decoded up to the first error.
+        \param result The result of decoding of the record.
+        \returns false if there are no more records.
+    */
+    bool next(Polyline &points, Result &result);
+
+    //! Decodes the next record into the fixed-point \p points.
+    bool next(PolylineE5 &points, Result &result);
+
+    //! Returns the 1-based line number of the last read record.
+    size_t lineNumber() const;
+
+    //! Starts reading from the first record again.
+    void rewind();
+
+private:
+    //! Returns the next line without the line break.
+    bool nextLine(const char *&line, size_t &size);
+
+    MappedFile m_file;
+
+    const char *m_data{ nullptr };
+    const char *m_end{ nullptr };
+    const char *m_it{ nullptr };
+    size_t m_lineNumber{ 0 };
+    bool m_open{ false };
+};
+
+//! Writes newline-delimited encoded polylines.
+/*!
+    The polylines are encoded directly into a large buffer, which is written out
+    at once when it is full, without intermediate strings.
+*/
+template<int Digits = 5>
+class PolylineWriter
+{
+public:
+    using Encoder    = PolylineEncoder<Digits>;
+    using Polyline   = typename Encoder::Polyline;
+    using PolylineE5 = typename Encoder::PolylineE5;
+
+    //! Creates a writer without output.
+    PolylineWriter() = default;
+
+    //! Creates a writer to the opened \p file, e.g. stdout, that stays owned by the caller.
+    explicit PolylineWriter(std::FILE *file, size_t bufferSize = s_defaultBufferSize);
+
+    //! Flushes and closes the output.
+    ~PolylineWriter();
+
+    PolylineWriter(const PolylineWriter &) = delete;
+    PolylineWriter &operator=(const PolylineWriter &) = delete;
+
+    //! Creates or truncates the file at the given \p path for writing.
+    /*!
+        \returns false if the file cannot be opened.
+    */
+    bool open(const std::string &path, size_t bufferSize = s_defaultBufferSize);
+
+    //! Flushes and closes the output.
+    /*!
+        \returns false if any of the writes failed.
+    */
+    bool close();
+
+    //! Returns true if there is an output to write to.
+    bool isOpen() const;
+
+    //! Encodes the \p polyline as the next record.
+    bool write(const Polyline &polyline);
+
+    //! Encodes the fixed-point \p polyline as the next record.
+    bool write(const PolylineE5 &polyline);
+
+    //! Writes the \p size characters of the already encoded polyline as the next record.
+    bool write(const char *data, size_t size);
+
+    //! Writes the buffered records out.
+    /*!
+        \returns false if any of the writes failed.
+    */
+    bool flush();
+
+private:
+    //! Terminates the record and writes the buffer out when it is full.
+    bool endRecord();
+
+    std::FILE *m_file{ nullptr };
+    bool m_ownsFile{ false };
+    bool m_failed{ false };
+
+    std::string m_buffer;
+    size_t m_bufferSize{ s_defaultBufferSize };
+
+    static constexpr const size_t s_defaultBufferSize = 1 << 20;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MappedFile implementation
+///////////////////////////////////////////////////////////////////////////////
+inline MappedFile::~MappedFile()
+{
+    close();
+}
+
+inline bool MappedFile::open(const std::string &path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    if (size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            m_data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);
+        }
+        if (!m_data) {
+            CloseHandle(file);
+            return false;
+        }
+    }
+    CloseHandle(file);
+    m_size = static_cast<size_t>(size.QuadPart);
+#else
+    const int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(file, &info) != 0) {
+        ::close(file);
+        return false;
+    }
+
+    // Empty files cannot be mapped.
+    if (info.st_size > 0) {
+        void *data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        if (data == MAP_FAILED) {
+            ::close(file);
+            return false;
+        }
+        // The records are read one after another.
+        madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+        m_data = static_cast<const char *>(data);
+    }
+    // The mapping stays valid after the file is closed.
+    ::close(file);
+    m_size = static_cast<size_t>(info.st_size);
+#endif
+
+    m_open = true;
+    return true;
+}
+
+inline void MappedFile::close()
+{
+    if (m_data) {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap(const_cast<char *>(m_data), m_size);
+#endif
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_open = false;
+}
+
+inline bool MappedFile::isOpen() const
+{
+    return m_open;
+}
+
+inline const char *MappedFile::data() const
+{
+    return m_data;
+}
+
+inline size_t MappedFile::size() const
+{
+    return m_size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PolylineReader implementation
+///////////////////////////////////////////////////////////////////////////////
+template<int Digits>
+PolylineReader<Digits>::PolylineReader(const char *data, size_t size)
+    : m_data(data)
+    , m_end(data + size)
+    , m_it(data)
+    , m_open(true)
+{}
+
+template<int Digits>
+bool PolylineReader<Digits>::open(const std::string &path)
+{
+    m_open = m_file.open(path);
+    m_data = m_file.data();
+    m_end = m_data + m_file.size();
+    rewind();
+    return m_open;
+}
+
+template<int Digits>
+bool PolylineReader<Digits>::isOpen() const
+{
+    return m_open;
+}
+
+template<int Digits>
+bool PolylineReader<Digits>::nextLine(const char *&line, size_t &size)
+{
+    if (m_it == m_end) {
+        return false;
+    }
+
+    const auto *newLine = static_cast<const char *>(std::memchr(m_it, '\n', static_cast<size_t>(m_end - m_it)));
+    const char *lineEnd = newLine ? newLine : m_end;
+
+    line = m_it;
+    size = static_cast<size_t>(lineEnd - m_it);
+    if (size > 0 && line[size - 1] == '\r') {
+        --size;
+    }
+
+    m_it = newLine ? newLine + 1 : m_end;
+    ++m_lineNumber;
+    return true;
+}
+
+template<int Digits>
+bool PolylineReader<Digits>::next(PolylineView<Digits> &record)
+{
+    const char *line = nullptr;
+    size_t size = 0;
+    if (!nextLine(line, size)) {
+        return false;
+    }
+    record = PolylineView<Digits>(line, size);
+    return true;
+}
+
+template<int Digits>
+bool PolylineReader<Digits>::next(Polyline &points, Result &result)
+{
+    const char *line = nullptr;
+    size_t size = 0;
+    if (!nextLine(line, size)) {
+        return false;
+    }
+
+    points.clear();
+    result = Encoder::decodePoints(line, line + size, [&points](int32_t lat, int32_t lon) {
+        points.push_back(Encoder::Point::fromE5(lat, lon));
+    });
+    return true;
+}
+
+template<int Digits>
+bool PolylineReader<Digits>::next(PolylineE5 &points, Result &result)
+{
+    const char *line = nullptr;
+    size_t size = 0;
+    if (!nextLine(line, size)) {
+        return false;
+    }
+
+    points.clear();
+    result = Encoder::decodePoints(line, line + size, [&points](int32_t lat, int32_t lon) {
+        points.push_back(typename Encoder::PointE5{ lat, lon });
+    });
+    return true;
+}
+
+template<int Digits>
+size_t PolylineReader<Digits>::lineNumber() const
+{
+    return m_lineNumber;
+}
+
+template<int Digits>
+void PolylineReader<Digits>::rewind()
+{
+    m_it = m_data;
+    m_lineNumber = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PolylineWriter implementation
+///////////////////////////////////////////////////////////////////////////////
+template<int Digits>
+PolylineWriter<Digits>::PolylineWriter(std::FILE *file, size_t bufferSize)
+    : m_file(file)
+    , m_bufferSize(bufferSize)
+{
+    m_buffer.reserve(m_bufferSize);
+}
+
+template<int Digits>
+PolylineWriter<Digits>::~PolylineWriter()
+{
+    close();
+}
+
+template<int Digits>
+bool PolylineWriter<Digits>::open(const std::string &path, size_t bufferSize)
+{
+    close();
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        return false;
+    }
+    m_ownsFile = true;
+    m_failed = false;
+    m_bufferSize = bufferSize;
+    m_buffer.reserve(m_bufferSize);
+    return true;
+}
+
+template<int Digits>
+bool PolylineWriter<Digits>::close()
+{
+    if (!m_file) {
+        return !m_failed;
+    }
+
+    flush();
+    if (m_ownsFile && std::fclose(m_file) != 0) {
+        m_failed = true;
+    }
+    m_file = nullptr;
+    m_ownsFile = false;
+    return !m_failed;
+}
+
+template<int Digits>
+bool PolylineWriter<Digits>::isOpen() const
+{
+    return m_file != nullptr;
+}
+
+template<int Digits>
+bool PolylineWriter<Digits>::write(const Polyline &polyline)
+{
+    Encoder::encode(polyline, m_buffer);
+    return endRecord();
+}
+
+template<int Digits>
+bool PolylineWriter<Digits>::write(const PolylineE5 &polyline)
+{
+    Encoder::encodeE5(polyline, m_buffer);
+    return endRecord();
+}
+
+template<int Digits>
+bool PolylineWriter<Digits>::write(const char *data, size_t size)
+{
+    m_buffer.append(data, size);
+    return endRecord();
+}
+
+template<int Digits>
+bool PolylineWriter<Digits>::endRecord()
+{
+    m_buffer.push_back('\n');
+    if (m_buffer.size() >= m_bufferSize) {
+        return flush();
+    }
+    return !m_failed;
+}
+
+template<int Digits>
+bool PolylineWriter<Digits>::flush()
+{
+    if (!m_file) {
+        m_buffer.clear();
+        return false;
+    }
+
+    if (!m_buffer.empty() && std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size()) {
+        m_failed = true;
+    }
+    m_buffer.clear();
+    if (std::fflush(m_file) != 0) {
+        m_failed = true;
+    }
+    return !m_failed;
+}
+
+} // namespace
+
+#endif // POLYLINEFILE_H
@@ -0,0 +1,650 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2017 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef POLYLINEINDEX_H
+#define POLYLINEINDEX_H
+
+#include "polylineencoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace gepaf
+{
+
+//! The sidecar index of an encoded polyline, for random access without decoding the whole polyline.
+/*!
+    The points are grouped in blocks of a fixed number of points. For each block
+    the index records the byte offset of its first point in the encoded string,
+    the absolute coordinates of the point before it to accumulate the offsets
+    from, and the bounding box of its points. Thus any point is found by
+    decoding at most one block, and any range of points is decoded starting
+    from the nearest block.
+
+    The index does not keep the encoded string, it must be given to each lookup.
+    The index can be serialized to be stored next to the encoded polyline.
+*/
+template<int Digits = 5>
+class PolylineIndex
+{
+public:
+    using Encoder = PolylineEncoder<Digits>;
+    using PointE5 = typename Encoder::PointE5;
+    using PolylineE5 = typename Encoder::PolylineE5;
+    using BoundingBox = typename Encoder::BoundingBox;
+    using Status = typename Encoder::Status;
+    using Result = typename Encoder::Result;
+
+    /// A block of points.
+    struct Block
+    {
+        /// The byte offset of the first point of the block.
+        size_t offset;
+
+        /// The absolute coordinates of the last point of the previous block, zero for the first block.
+        PointE5 previous;
+
+        /// The bounding box of the points of the block.
+        /*!
+            The box includes the last point of the previous block, so that it covers
+            all segments that end in the block.
+        */
+        BoundingBox box;
+    };
+
+    //! Creates an empty index.
+    PolylineIndex() = default;
+
+    //! Builds the index of the encoded polyline given by the \p size characters of \p data.
+    /*!
+        \param blockSize The number of points per block, the smaller the faster the lookups.
+        \returns The result of decoding. The index is empty if the polyline is invalid.
+    */
+    Result build(const char *data, size_t size, size_t blockSize = s_defaultBlockSize);
+
+    //! Builds the index of the given encoded polyline \p coordinates.
+    Result build(const std::string &coordinates, size_t blockSize = s_defaultBlockSize);
+
+    //! Returns the number of points of the indexed polyline.
+    size_t pointCount() const;
+
+    //! Returns the number of points per block.
+    size_t blockSize() const;
+
+    //! Returns the blocks of points.
+    const std::vector<Block> &blocks() const;
+
+    //! Returns the bounding box of the whole polyline, all coordinates are zero if it is empty.
+    BoundingBox bounds() const;
+
+    //! Finds the point at the given \p index, decoding at most one block.
+    /*!
+        \param data The encoded polyline the index is built for.
+        \returns false if the \p index is out of range or the string does not match the index.
+    */
+    bool point(const char *data, size_t size, size_t index, PointE5 &point) const;
+
+    //! Appends the points in the [\p begin, \p end) range to the \p polyline, decoding only the
+    //! blocks they belong to.
+    /*!
+        The range is clamped to the number of points.
+        \returns false if the string does not match the index.
+    */
+    bool decode(const char *data, size_t size, size_t begin, size_t end, PolylineE5 &polyline) const;
+
+    //! Appends the indices of the blocks, the boxes of which intersect the given \p box, to the \p blocks.
+    /*!
+        The points of the block \c i are in the [i * blockSize(), (i + 1) * blockSize())
+        range, the segment into the block starts at the point before it.
+    */
+    void query(const BoundingBox &box, std::vector<size_t> &blocks) const;
+
+    //! Appends the serialized index to the \p sidecar string.
+    void serialize(std::string &sidecar) const;
+
+    //! Restores the index serialized by serialize().
+    /*!
+        \returns false if the data is not a valid index, the index is empty then.
+    */
+    bool deserialize(const char *data, size_t size);
+
+    //! Returns true if the boxes intersect, the borders are inclusive.
+    static bool intersects(const BoundingBox &first, const BoundingBox &second);
+
+private:
+    //! Extends the \p box to include the \p point.
+    static void extend(BoundingBox &box, const PointE5 &point);
+
+    //! Decodes points from the start of the block containing the point \p index.
+    /*!
+        The \p emit function is called with every point from the \p index to the
+        \p end. Returns false if the string does not match the index.
+    */
+    template<typename Emit>
+    bool decodeFrom(const char *data, size_t size, size_t index, size_t end, Emit &&emit) const;
+
+    //! Writes the \p value of \p bytes bytes in the little-endian order.
+    static void put(std::string &out, uint64_t value, int bytes);
+
+    //! Reads the value of \p bytes bytes in the little-endian order and advances the \p it.
+    static uint64_t get(const char *&it, int bytes);
+
+    void clear();
+
+    std::vector<Block> m_blocks;
+    size_t m_pointCount{ 0 };
+    size_t m_blockSize{ s_defaultBlockSize };
+
+    //! The size of the indexed string, to detect mismatches.
+    size_t m_size{ 0 };
+
+    //! The default number of points per block.
+    static constexpr const size_t s_defaultBlockSize = 64;
+
+    //! The sizes of the serialized header and blocks.
+    static constexpr const char *s_magic = "GPI1";
+    static constexpr const size_t s_headerSize = 4 + 4 + 4 * 8;
+    static constexpr const size_t s_serializedBlockSize = 8 + 6 * 4;
+};
+
+//! A packed R-tree of bounding boxes, e.g. of the blocks of many indexed polylines.
+/*!
+    The tree is bulk loaded once with the Sort-Tile-Recursive algorithm and
+    stored in flat arrays, level by level, so it is compact and cache friendly,
+    but cannot be modified afterwards.
+*/
+template<int Digits = 5>
+class PolylineRTree
+{
+public:
+    using BoundingBox = typename PolylineEncoder<Digits>::BoundingBox;
+
+    /// An indexed box.
+    struct Entry
+    {
+        BoundingBox box;
+
+        /// The user-defined identifier of the polyline.
+        size_t polyline;
+
+        /// The index of the block within the polyline.
+        size_t block;
+    };
+
+    //! Adds the box of the \p block of the \p polyline to be indexed.
+    void add(size_t polyline, size_t block, const BoundingBox &box);
+
+    //! Adds the boxes of all blocks of the \p index of the \p polyline.
+    void add(size_t polyline, const PolylineIndex<Digits> &index);
+
+    //! Builds the tree of the added boxes.
+    /*!
+        The entries are reordered, boxes added afterwards require another build.
+    */
+    void build(size_t nodeSize = s_defaultNodeSize);
+
+    //! Returns the number of indexed boxes.
+    size_t size() const;
+
+    //! Calls the \p visit function with each entry, the box of which intersects the given \p box.
+    template<typename Visit>
+    void query(const BoundingBox &box, Visit &&visit) const;
+
+    //! Returns the entries, the boxes of which intersect the given \p box.
+    std::vector<Entry> query(const BoundingBox &box) const;
+
+private:
+    template<typename Visit>
+    void query(const BoundingBox &box, size_t level, size_t node, Visit &visit) const;
+
+    //! Returns the center of the \p box along the longitudes or the latitudes, doubled to stay integer.
+    static int64_t center(const BoundingBox &box, bool longitude);
+
+    std::vector<Entry> m_entries;
+
+    //! The boxes of the nodes, from the level above the entries to the root.
+    std::vector<std::vector<BoundingBox>> m_levels;
+
+    size_t m_nodeSize{ s_defaultNodeSize };
+
+    //! The default number of children of each node.
+    static constexpr const size_t s_defaultNodeSize = 16;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PolylineIndex implementation
+///////////////////////////////////////////////////////////////////////////////
+template<int Digits>
+typename PolylineIndex<Digits>::Result PolylineIndex<Digits>::build(const char *data, size_t size,
+                                                                    size_t blockSize)
+{
+    clear();
+    m_blockSize = blockSize > 0 ? blockSize : 1;
+
+    const char *it = data;
+    const char *end = data + size;
+
+    uint32_t lat = 0;
+    uint32_t lon = 0;
+    size_t count = 0;
+
+    while (it != end) {
+        const char *start = it;
+        const PointE5 previous{ static_cast<int32_t>(lat), static_cast<int32_t>(lon) };
+
+        int32_t latDelta = 0;
+        int32_t lonDelta = 0;
+        const auto status = Encoder::decodePoint(it, end, latDelta, lonDelta);
+        if (status != Status::Ok) {
+            clear();
+            return Result{ status, static_cast<size_t>(it - data), count };
+        }
+
+        lat += static_cast<uint32_t>(latDelta);
+        lon += static_cast<uint32_t>(lonDelta);
+        if (!Encoder::isValid(lat, lon)) {
+            clear();
+            return Result{ Status::OutOfRange, static_cast<size_t>(start - data), count };
+        }
+
+        const PointE5 point{ static_cast<int32_t>(lat), static_cast<int32_t>(lon) };
+        if (count % m_blockSize == 0) {
+            const auto &first = count > 0 ? previous : point;
+            m_blocks.push_back(Block{ static_cast<size_t>(start - data), previous, BoundingBox{ first, first } });
+        }
+        extend(m_blocks.back().box, point);
+        ++count;
+    }
+
+    m_pointCount = count;
+    m_size = size;
+    return Result{ Status::Ok, size, count };
+}
+
+template<int Digits>
+typename PolylineIndex<Digits>::Result PolylineIndex<Digits>::build(const std::string &coords, size_t blockSize)
+{
+    return build(coords.data(), coords.size(), blockSize);
+}
+
+template<int Digits>
+size_t PolylineIndex<Digits>::pointCount() const
+{
+    return m_pointCount;
+}
+
+template<int Digits>
+size_t PolylineIndex<Digits>::blockSize() const
+{
+    return m_blockSize;
+}
+
+template<int Digits>
+const std::vector<typename PolylineIndex<Digits>::Block> &PolylineIndex<Digits>::blocks() const
+{
+    return m_blocks;
+}
+
+template<int Digits>
+typename PolylineIndex<Digits>::BoundingBox PolylineIndex<Digits>::bounds() const
+{
+    if (m_blocks.empty()) {
+        return BoundingBox{ PointE5{ 0, 0 }, PointE5{ 0, 0 } };
+    }
+
+    auto box = m_blocks.front().box;
+    for (const auto &block : m_blocks) {
+        extend(box, block.box.min);
+        extend(box, block.box.max);
+    }
+    return box;
+}
+
+template<int Digits>
+bool PolylineIndex<Digits>::point(const char *data, size_t size, size_t index, PointE5 &point) const
+{
+    if (index >= m_pointCount) {
+        return false;
+    }
+    return decodeFrom(data, size, index, index + 1, [&point](const PointE5 &current) {
+        point = current;
+    });
+}
+
+template<int Digits>
+bool PolylineIndex<Digits>::decode(const char *data, size_t size, size_t begin, size_t end,
+                                   PolylineE5 &polyline) const
+{
+    end = std::min(end, m_pointCount);
+    if (begin >= end) {
+        return size == m_size;
+    }
+
+    polyline.reserve(polyline.size() + (end - begin));
+    return decodeFrom(data, size, begin, end, [&polyline](const PointE5 &point) {
+        polyline.push_back(point);
+    });
+}
+
+template<int Digits>
+void PolylineIndex<Digits>::query(const BoundingBox &box, std::vector<size_t> &blocks) const
+{
+    for (size_t i = 0; i < m_blocks.size(); ++i) {
+        if (intersects(m_blocks[i].box, box)) {
+            blocks.push_back(i);
+        }
+    }
+}
+
+template<int Digits>
+void PolylineIndex<Digits>::serialize(std::string &sidecar) const
+{
+    sidecar.reserve(sidecar.size() + s_headerSize + m_blocks.size() * s_serializedBlockSize);
+
+    sidecar.append(s_magic, 4);
+    put(sidecar, static_cast<uint64_t>(Digits), 4);
+    put(sidecar, m_size, 8);
+    put(sidecar, m_pointCount, 8);
+    put(sidecar, m_blockSize, 8);
+    put(sidecar, m_blocks.size(), 8);
+
+    for (const auto &block : m_blocks) {
+        put(sidecar, block.offset, 8);
+        for (const auto value : { block.previous.latitude, block.previous.longitude,
+                                  block.box.min.latitude, block.box.min.longitude,
+                                  block.box.max.latitude, block.box.max.longitude }) {
+            put(sidecar, static_cast<uint32_t>(value), 4);
+        }
+    }
+}
+
+template<int Digits>
+bool PolylineIndex<Digits>::deserialize(const char *data, size_t size)
+{
+    clear();
+    if (size < s_headerSize || std::memcmp(data, s_magic, 4) != 0) {
+        return false;
+    }
+
+    const char *it = data + 4;
+    const auto digits = get(it, 4);
+    const auto stringSize = get(it, 8);
+    const auto pointCount = get(it, 8);
+    const auto blockSize = get(it, 8);
+    const auto blockCount = get(it, 8);
+
+    // The block count follows from the point count, thus it cannot be arbitrarily large.
+    // It is computed without adding to the point count, which may be anything in a corrupted header.
+    const uint64_t maxSize = std::numeric_limits<size_t>::max();
+    if (digits != static_cast<uint64_t>(Digits) || blockSize == 0 || stringSize > maxSize ||
+        pointCount > maxSize || blockSize > maxSize ||
+        blockCount != pointCount / blockSize + (pointCount % blockSize != 0 ? 1 : 0) ||
+        blockCount > (size - s_headerSize) / s_serializedBlockSize ||
+        size != s_headerSize + blockCount * s_serializedBlockSize) {
+        return false;
+    }
+
+    m_blocks.reserve(static_cast<size_t>(blockCount));
+    for (uint64_t i = 0; i < blockCount; ++i) {
+        Block block;
+        block.offset = static_cast<size_t>(get(it, 8));
+        int32_t values[6];
+        for (auto &value : values) {
+            value = static_cast<int32_t>(static_cast<uint32_t>(get(it, 4)));
+        }
+        block.previous = PointE5{ values[0], values[1] };
+        block.box = BoundingBox{ PointE5{ values[2], values[3] }, PointE5{ values[4], values[5] } };
+
+        // The blocks must start within the string, one after another, from its beginning.
+        if (block.offset >= stringSize || (m_blocks.empty() && block.offset != 0) ||
+            (!m_blocks.empty() && block.offset <= m_blocks.back().offset)) {
+            clear();
+            return false;
+        }
+        m_blocks.push_back(block);
+    }
+
+    m_size = static_cast<size_t>(stringSize);
+    m_pointCount = static_cast<size_t>(pointCount);
+    m_blockSize = static_cast<size_t>(blockSize);
+    return true;
+}
+
+template<int Digits>
+bool PolylineIndex<Digits>::intersects(const BoundingBox &first, const BoundingBox &second)
+{
+    return first.min.latitude <= second.max.latitude && second.min.latitude <= first.max.latitude &&
+           first.min.longitude <= second.max.longitude && second.min.longitude <= first.max.longitude;
+}
+
+template<int Digits>
+void PolylineIndex<Digits>::extend(BoundingBox &box, const PointE5 &point)
+{
+    box.min.latitude = std::min(box.min.latitude, point.latitude);
+    box.min.longitude = std::min(box.min.longitude, point.longitude);
+    box.max.latitude = std::max(box.max.latitude, point.latitude);
+    box.max.longitude = std::max(box.max.longitude, point.longitude);
+}
+
+template<int Digits>
+template<typename Emit>
+bool PolylineIndex<Digits>::decodeFrom(const char *data, size_t size, size_t index, size_t end,
+                                       Emit &&emit) const
+{
+    if (size != m_size) {
+        return false;
+    }
+
+    const auto &block = m_blocks[index / m_blockSize];
+    const char *it = data + block.offset;
+    const char *last = data + size;
+
+    auto lat = static_cast<uint32_t>(block.previous.latitude);
+    auto lon = static_cast<uint32_t>(block.previous.longitude);
+
+    for (size_t i = index - index % m_blockSize; i < end; ++i) {
+        int32_t latDelta = 0;
+        int32_t lonDelta = 0;
+        if (Encoder::decodePoint(it, last, latDelta, lonDelta) != Status::Ok) {
+            return false;
+        }
+
+        // The string may be of the right size, but not the indexed one.
+        lat += static_cast<uint32_t>(latDelta);
+        lon += static_cast<uint32_t>(lonDelta);
+        if (!Encoder::isValid(lat, lon)) {
+            return false;
+        }
+        if (i >= index) {
+            emit(PointE5{ static_cast<int32_t>(lat), static_cast<int32_t>(lon) });
+        }
+    }
+    return true;
+}
+
+template<int Digits>
+void PolylineIndex<Digits>::put(std::string &out, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+template<int Digits>
+uint64_t PolylineIndex<Digits>::get(const char *&it, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(*it++)) << (8 * i);
+    }
+    return value;
+}
+
+template<int Digits>
+void PolylineIndex<Digits>::clear()
+{
+    m_blocks.clear();
+    m_pointCount = 0;
+    m_size = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PolylineRTree implementation
+///////////////////////////////////////////////////////////////////////////////
+template<int Digits>
+void PolylineRTree<Digits>::add(size_t polyline, size_t block, const BoundingBox &box)
+{
+    m_entries.push_back(Entry{ box, polyline, block });
+}
+
+template<int Digits>
+void PolylineRTree<Digits>::add(size_t polyline, const PolylineIndex<Digits> &index)
+{
+    const auto &blocks = index.blocks();
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        add(polyline, i, blocks[i].box);
+    }
+}
+
+template<int Digits>
+void PolylineRTree<Digits>::build(size_t nodeSize)
+{
+    m_nodeSize = nodeSize > 1 ? nodeSize : 2;
+    m_levels.clear();
+
+    // Sort-Tile-Recursive: sort by longitudes, cut into vertical slices of
+    // whole nodes and sort each slice by latitudes.
+    const size_t count = m_entries.size();
+    const size_t nodeCount = (count + m_nodeSize - 1) / m_nodeSize;
+    const auto sliceCount = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(nodeCount))));
+    const size_t sliceSize = sliceCount * m_nodeSize;
+
+    std::sort(m_entries.begin(), m_entries.end(), [](const Entry &l, const Entry &r) {
+        return center(l.box, true) < center(r.box, true);
+    });
+    for (size_t first = 0; first < count; first += sliceSize) {
+        const size_t last = std::min(first + sliceSize, count);
+        std::sort(m_entries.begin() + first, m_entries.begin() + last, [](const Entry &l, const Entry &r) {
+            return center(l.box, false) < center(r.box, false);
+        });
+    }
+
+    // Each level groups the consecutive boxes of the level below, up to the single root.
+    std::vector<BoundingBox> level;
+    level.reserve(count);
+    for (const auto &entry : m_entries) {
+        level.push_back(entry.box);
+    }
+
+    while (level.size() > 1) {
+        std::vector<BoundingBox> parents;
+        parents.reserve((level.size() + m_nodeSize - 1) / m_nodeSize);
+        for (size_t i = 0; i < level.size(); i += m_nodeSize) {
+            auto box = level[i];
+            for (size_t j = i + 1; j < std::min(i + m_nodeSize, level.size()); ++j) {
+                box.min.latitude = std::min(box.min.latitude, level[j].min.latitude);
+                box.min.longitude = std::min(box.min.longitude, level[j].min.longitude);
+                box.max.latitude = std::max(box.max.latitude, level[j].max.latitude);
+                box.max.longitude = std::max(box.max.longitude, level[j].max.longitude);
+            }
+            parents.push_back(box);
+        }
+        m_levels.push_back(parents);
+        level.swap(parents);
+    }
+}
+
+template<int Digits>
+size_t PolylineRTree<Digits>::size() const
+{
+    return m_entries.size();
+}
+
+template<int Digits>
+template<typename Visit>
+void PolylineRTree<Digits>::query(const BoundingBox &box, Visit &&visit) const
+{
+    if (m_levels.empty()) {
+        // A single entry or none at all.
+        for (const auto &entry : m_entries) {
+            if (PolylineIndex<Digits>::intersects(entry.box, box)) {
+                visit(entry);
+            }
+        }
+        return;
+    }
+
+    query(box, m_levels.size() - 1, 0, visit);
+}
+
+template<int Digits>
+std::vector<typename PolylineRTree<Digits>::Entry> PolylineRTree<Digits>::query(const BoundingBox &box) const
+{
+    std::vector<Entry> entries;
+    query(box, [&entries](const Entry &entry) {
+        entries.push_back(entry);
+    });
+    return entries;
+}
+
+template<int Digits>
+template<typename Visit>
+void PolylineRTree<Digits>::query(const BoundingBox &box, size_t level, size_t node, Visit &visit) const
+{
+    if (!PolylineIndex<Digits>::intersects(m_levels[level][node], box)) {
+        return;
+    }
+
+    const size_t first = node * m_nodeSize;
+    if (level == 0) {
+        const size_t last = std::min(first + m_nodeSize, m_entries.size());
+        for (size_t i = first; i < last; ++i) {
+            if (PolylineIndex<Digits>::intersects(m_entries[i].box, box)) {
+                visit(m_entries[i]);
+            }
+        }
+        return;
+    }
+
+    const size_t last = std::min(first + m_nodeSize, m_levels[level - 1].size());
+    for (size_t i = first; i < last; ++i) {
+        query(box, level - 1, i, visit);
+    }
+}
+
+template<int Digits>
+int64_t PolylineRTree<Digits>::center(const BoundingBox &box, bool longitude)
+{
+    return longitude ? static_cast<int64_t>(box.min.longitude) + box.max.longitude
+                     : static_cast<int64_t>(box.min.latitude) + box.max.latitude;
+}
+
+} // namespace
+
+#endif // POLYLINEINDEX_H
@@ -0,0 +1,384 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2017 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef POLYLINESTATS_H
+#define POLYLINESTATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <string>
+
+namespace gepaf
+{
+
+//! The statistics of the encoding and the decoding of polylines.
+/*!
+    The statistics are collected only if the POLYLINEENCODER_ENABLE_STATS macro
+    is defined before polylineencoder.h is included (in all translation units),
+    otherwise this header is not included and the codec has no hooks at all.
+
+    Each thread counts in its own block of counters, without locks and shared
+    cache lines, the blocks are summed up when a snapshot is taken. The blocks
+    outlive their threads, so the counts of finished threads are kept, and are
+    handed over to new threads. Thus the number of blocks, and the cost of a
+    snapshot, is bounded by the largest number of threads that counted at once,
+    even if a thread is started per request.
+
+    The decoding counts the PolylineEncoder functions that decode whole strings,
+    including validation, aggregates and columns, and the ones built on them:
+    PolylineBatch::decode(), PolylineReader, PolylineCodec for two dimensions and
+    5 to 7 digits, PolylineBinary::fromPolyline() and decodeParallel() for strings
+    too short to be split. The encoding counts the functions that append to strings
+    and the points added to encoders.
+
+    Not counted are PolylineDecoder, PolylineView, PolylineIndex, concat(),
+    slice() and splice(), the parallel path of decodeParallel(),
+    PolylineCodec for other dimensions and precisions, the functions that write
+    to output iterators and the compile-time functions.
+*/
+class PolylineStats
+{
+public:
+    /// The totals of all threads since the start or since the last reset().
+    struct Snapshot
+    {
+        uint64_t encodeCalls;
+        uint64_t encodedPoints;
+        uint64_t encodedBytes;
+        uint64_t encodeNanoseconds;
+
+        /// The number of encoded values by their sizes in characters, from 1 to 7 (the index 0 is unused).
+        uint64_t valueSizes[8];
+
+        uint64_t decodeCalls;
+        uint64_t decodedPoints;
+        uint64_t decodedBytes;
+        uint64_t decodeNanoseconds;
+
+        /// The number of rejected strings by the PolylineEncoder::Status (the index 0, Ok, is unused).
+        uint64_t rejected[5];
+    };
+
+    /// The measured operation.
+    enum class Operation
+    {
+        Encode,
+        Decode
+    };
+
+    //! Counts a call and measures its time from the construction to the destruction.
+    class Scope
+    {
+    public:
+        explicit Scope(Operation operation);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Operation m_operation;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    //! Returns the totals of all threads.
+    static Snapshot snapshot();
+
+    //! Starts counting from zero.
+    /*!
+        The counters are not modified, the current totals are subtracted from the
+        next snapshots instead, so that the threads keep counting without locks.
+    */
+    static void reset();
+
+    //! Returns the snapshot as text, one "name value" pair per line.
+    static std::string dump();
+
+    //! Returns the number of the blocks of counters, i.e. the largest number of threads that counted at once.
+    static size_t blockCount();
+
+    //! Counts the encoded points and characters, and the values by their \p valueSizes.
+    static void encoded(size_t points, size_t bytes, const size_t (&valueSizes)[8]);
+
+    //! Counts the decoded points and characters, and the rejected string if the \p status is not Ok (0).
+    static void decoded(size_t points, size_t bytes, int status);
+
+private:
+    enum Counter
+    {
+        EncodeCalls,
+        EncodedPoints,
+        EncodedBytes,
+        EncodeNanoseconds,
+        ValueSizes,
+        DecodeCalls = ValueSizes + 8,
+        DecodedPoints,
+        DecodedBytes,
+        DecodeNanoseconds,
+        Rejected,
+        CounterCount = Rejected + 5
+    };
+
+    //! The counters of a thread, only the thread writes them.
+    /*!
+        The blocks are aligned to cache lines, so that threads do not write to the same lines.
+    */
+    struct alignas(64) Block
+    {
+        std::atomic<uint64_t> values[CounterCount];
+
+        /// True while a thread owns the block, the ownership is handed over with the acquire-release ordering.
+        std::atomic<bool> owned;
+
+        Block *next;
+    };
+
+    //! Releases the block of a thread when the thread finishes.
+    struct Owner
+    {
+        Block *block;
+        ~Owner();
+    };
+
+    //! All blocks and the totals at the last reset.
+    struct Registry
+    {
+        std::atomic<Block *> head;
+        std::mutex mutex;
+        uint64_t baseline[CounterCount];
+    };
+
+    static Registry &registry();
+
+    //! Returns the block of the current thread, taken over from a finished thread or created on the first use.
+    static Block &local();
+
+    //! Returns an owned block, a released one if there is any.
+    static Block *acquire();
+
+    static void add(int counter, uint64_t value);
+
+    //! Sums up the counters of all blocks.
+    static void sum(uint64_t (&totals)[CounterCount]);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PolylineStats implementation
+///////////////////////////////////////////////////////////////////////////////
+inline PolylineStats::Scope::Scope(Operation operation)
+    : m_operation(operation)
+    , m_start(std::chrono::steady_clock::now())
+{}
+
+inline PolylineStats::Scope::~Scope()
+{
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - m_start).count();
+    const bool encode = m_operation == Operation::Encode;
+    add(encode ? EncodeCalls : DecodeCalls, 1);
+    add(encode ? EncodeNanoseconds : DecodeNanoseconds, static_cast<uint64_t>(elapsed));
+}
+
+inline PolylineStats::Snapshot PolylineStats::snapshot()
+{
+    uint64_t totals[CounterCount];
+    sum(totals);
+
+    auto &reg = registry();
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (int i = 0; i < CounterCount; ++i) {
+            totals[i] -= reg.baseline[i];
+        }
+    }
+
+    Snapshot snapshot;
+    snapshot.encodeCalls = totals[EncodeCalls];
+    snapshot.encodedPoints = totals[EncodedPoints];
+    snapshot.encodedBytes = totals[EncodedBytes];
+    snapshot.encodeNanoseconds = totals[EncodeNanoseconds];
+    for (int i = 0; i < 8; ++i) {
+        snapshot.valueSizes[i] = totals[ValueSizes + i];
+    }
+    snapshot.decodeCalls = totals[DecodeCalls];
+    snapshot.decodedPoints = totals[DecodedPoints];
+    snapshot.decodedBytes = totals[DecodedBytes];
+    snapshot.decodeNanoseconds = totals[DecodeNanoseconds];
+    for (int i = 0; i < 5; ++i) {
+        snapshot.rejected[i] = totals[Rejected + i];
+    }
+    return snapshot;
+}
+
+inline void PolylineStats::reset()
+{
+    uint64_t totals[CounterCount];
+    sum(totals);
+
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (int i = 0; i < CounterCount; ++i) {
+        reg.baseline[i] = totals[i];
+    }
+}
+
+inline std::string PolylineStats::dump()
+{
+    const auto stats = snapshot();
+
+    std::string text;
+    const auto line = [&text](const char *name, uint64_t value) {
+        text += name;
+        text += ' ';
+        text += std::to_string(value);
+        text += '\n';
+    };
+
+    line("encode.calls", stats.encodeCalls);
+    line("encode.points", stats.encodedPoints);
+    line("encode.bytes", stats.encodedBytes);
+    line("encode.nanoseconds", stats.encodeNanoseconds);
+    const char *sizes[] = { "", "encode.values.1", "encode.values.2", "encode.values.3", "encode.values.4",
+                            "encode.values.5", "encode.values.6", "encode.values.7" };
+    for (int i = 1; i < 8; ++i) {
+        line(sizes[i], stats.valueSizes[i]);
+    }
+    line("decode.calls", stats.decodeCalls);
+    line("decode.points", stats.decodedPoints);
+    line("decode.bytes", stats.decodedBytes);
+    line("decode.nanoseconds", stats.decodeNanoseconds);
+    line("decode.rejected.incomplete", stats.rejected[1]);
+    line("decode.rejected.invalid_character", stats.rejected[2]);
+    line("decode.rejected.overflow", stats.rejected[3]);
+    line("decode.rejected.out_of_range", stats.rejected[4]);
+    return text;
+}
+
+inline size_t PolylineStats::blockCount()
+{
+    size_t count = 0;
+    for (auto block = registry().head.load(); block != nullptr; block = block->next) {
+        ++count;
+    }
+    return count;
+}
+
+inline void PolylineStats::encoded(size_t points, size_t bytes, const size_t (&valueSizes)[8])
+{
+    add(EncodedPoints, points);
+    add(EncodedBytes, bytes);
+    for (int i = 1; i < 8; ++i) {
+        add(ValueSizes + i, valueSizes[i]);
+    }
+}
+
+inline void PolylineStats::decoded(size_t points, size_t bytes, int status)
+{
+    add(DecodedPoints, points);
+    add(DecodedBytes, bytes);
+    if (status != 0) {
+        add(Rejected + status, 1);
+    }
+}
+
+inline PolylineStats::Registry &PolylineStats::registry()
+{
+    // Never destroyed, as the threads may count until the very end.
+    static Registry *reg = [] {
+        auto created = new Registry;
+        created->head.store(nullptr);
+        for (auto &value : created->baseline) {
+            value = 0;
+        }
+        return created;
+    }();
+    return *reg;
+}
+
+inline PolylineStats::Owner::~Owner()
+{
+    // The counts are kept, the next owner continues to add to them.
+    block->owned.store(false, std::memory_order_release);
+}
+
+inline PolylineStats::Block &PolylineStats::local()
+{
+    static thread_local Owner owner{ acquire() };
+    return *owner.block;
+}
+
+inline PolylineStats::Block *PolylineStats::acquire()
+{
+    auto &head = registry().head;
+    for (auto block = head.load(); block != nullptr; block = block->next) {
+        bool owned = false;
+        if (!block->owned.load(std::memory_order_relaxed) &&
+            block->owned.compare_exchange_strong(owned, true, std::memory_order_acquire)) {
+            return block;
+        }
+    }
+
+    // The blocks are never freed, so the storage is aligned by hand, as operator
+    // new does not respect the alignment of the over-aligned types before C++17.
+    void *storage = ::operator new(sizeof(Block) + alignof(Block));
+    const auto address = (reinterpret_cast<uintptr_t>(storage) + alignof(Block) - 1) &
+                         ~static_cast<uintptr_t>(alignof(Block) - 1);
+    auto created = new (reinterpret_cast<void *>(address)) Block;
+    for (auto &value : created->values) {
+        value.store(0, std::memory_order_relaxed);
+    }
+    created->owned.store(true, std::memory_order_relaxed);
+
+    created->next = head.load();
+    while (!head.compare_exchange_weak(created->next, created)) {
+    }
+    return created;
+}
+
+inline void PolylineStats::add(int counter, uint64_t value)
+{
+    // Only the owner thread writes, so a plain read and write is enough.
+    auto &total = local().values[counter];
+    total.store(total.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+inline void PolylineStats::sum(uint64_t (&totals)[CounterCount])
+{
+    for (auto &total : totals) {
+        total = 0;
+    }
+    for (auto block = registry().head.load(); block != nullptr; block = block->next) {
+        for (int i = 0; i < CounterCount; ++i) {
+            totals[i] += block->values[i].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace
+
+#endif // POLYLINESTATS_H
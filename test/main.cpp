@@ -23,9 +23,25 @@ SOFTWARE.
 */
 
 #include "polylineencoder.h"
+#include "polylinebatch.h"
+#include "polylinebinary.h"
+#include "polylinecodec.h"
+#include "polylinedifferential.h"
+#include "polylinefile.h"
+#include "polylineindex.h"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <thread>
+
 template<typename Point>
 bool operator==(const Point &l, const Point &r)
 {
@@ -258,6 +274,1759 @@ TEST(General, PrecisionTest2)
     EXPECT_EQ(encoder.encode(), "yyg_HkindBG[");
 }
 
+TEST(General, MaxEncodedSize)
+{
+    EXPECT_EQ(gepaf::PolylineEncoder<>::maxEncodedSize(0), 0);
+    EXPECT_EQ(gepaf::PolylineEncoder<>::maxEncodedSize(1), 12);
+    EXPECT_EQ(gepaf::PolylineEncoder<>::maxEncodedSize(3), 36);
+    EXPECT_EQ(gepaf::PolylineEncoder<1>::maxEncodedSize(1), 6);
+    EXPECT_EQ(gepaf::PolylineEncoder<6>::maxEncodedSize(1), 12);
+    EXPECT_EQ(gepaf::PolylineEncoder<7>::maxEncodedSize(1), 14);
+
+    // The extreme case: from (-90, -180) to (90, 180).
+    gepaf::PolylineEncoder<> encoder;
+    encoder.addPoint(-90.0, -180.0);
+    encoder.addPoint(90.0, 180.0);
+    EXPECT_LE(encoder.encode().size(), gepaf::PolylineEncoder<>::maxEncodedSize(2));
+}
+
+TEST(General, EncodeIntoBuffer)
+{
+    gepaf::PolylineEncoder<> encoder;
+    encoder.addPoint(38.5, -120.2);
+    encoder.addPoint(40.7, -120.95);
+    encoder.addPoint(43.252, -126.453);
+
+    char buffer[gepaf::PolylineEncoder<>::maxEncodedSize(3)];
+    auto end = gepaf::PolylineEncoder<>::encode(encoder.polyline(), buffer);
+    EXPECT_EQ(std::string(buffer, end), "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+
+    // Using an output iterator.
+    std::string result;
+    gepaf::PolylineEncoder<>::encode(encoder.polyline(), std::back_inserter(result));
+    EXPECT_EQ(result, "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+}
+
+struct Sample
+{
+    double latitude;
+    double longitude;
+};
+
+std::istream &operator>>(std::istream &stream, Sample &sample)
+{
+    return stream >> sample.latitude >> sample.longitude;
+}
+
+TEST(General, EncodeRangeAccessors)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    // The elements are accessed in place, so that they do not need to be copyable.
+    struct Track
+    {
+        Track(double latitude, double longitude) : latitude(latitude), longitude(longitude) {}
+        Track(const Track &) = delete;
+
+        double latitude;
+        double longitude;
+    };
+    const Track tracks[] = { { 38.5, -120.2 }, { 40.7, -120.95 }, { 43.252, -126.453 } };
+    EXPECT_EQ(Encoder::encode(std::begin(tracks), std::end(tracks), &Track::latitude, &Track::longitude),
+              "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+    EXPECT_EQ(Encoder::encode(std::begin(tracks), std::end(tracks),
+                              [](const Track &track) { return track.latitude; },
+                              [](const Track &track) { return track.longitude; }),
+              "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+
+    // Non-const accessors are accepted for mutable ranges, as std::invoke() does.
+    struct Legacy
+    {
+        double lat() { return latitude; }
+        double lon() { return longitude; }
+
+        double latitude;
+        double longitude;
+    };
+    std::vector<Legacy> legacy = { { 38.5, -120.2 }, { 40.7, -120.95 }, { 43.252, -126.453 } };
+    EXPECT_EQ(Encoder::encode(legacy.begin(), legacy.end(), &Legacy::lat, &Legacy::lon),
+              "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+    EXPECT_EQ(Encoder::encode(legacy.begin(), legacy.end(),
+                              [](Legacy &point) { return point.latitude; },
+                              [](Legacy &point) { return point.longitude; }),
+              "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+    std::string appended;
+    Encoder::encode(legacy.begin(), legacy.end(), &Legacy::lat, &Legacy::lon, std::back_inserter(appended));
+    EXPECT_EQ(appended, "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+
+    // The member pointers apply to the pointed and wrapped elements too.
+    using Point = Encoder::Point;
+    const Point points[] = { { 38.5, -120.2 }, { 40.7, -120.95 }, { 43.252, -126.453 } };
+    const std::vector<const Point *> pointers = { &points[0], &points[1], &points[2] };
+    EXPECT_EQ(Encoder::encode(pointers.begin(), pointers.end(), &Point::latitude, &Point::longitude),
+              "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+
+    std::vector<std::unique_ptr<Point>> owners;
+    for (const auto &point : points) {
+        owners.emplace_back(new Point(point));
+    }
+    EXPECT_EQ(Encoder::encode(owners.begin(), owners.end(), &Point::latitude, &Point::longitude),
+              "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+
+    const std::vector<std::reference_wrapper<const Point>> references(std::begin(points), std::end(points));
+    EXPECT_EQ(Encoder::encode(references.begin(), references.end(), &Point::latitude, &Point::longitude),
+              "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+
+    std::vector<Legacy *> legacyPointers = { &legacy[0], &legacy[1], &legacy[2] };
+    EXPECT_EQ(Encoder::encode(legacyPointers.begin(), legacyPointers.end(), &Legacy::lat, &Legacy::lon),
+              "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+    std::vector<Sample> sampleData = { { 38.5, -120.2 }, { 40.7, -120.95 }, { 43.252, -126.453 } };
+    std::vector<Sample *> samplePointers = { &sampleData[0], &sampleData[1], &sampleData[2] };
+    EXPECT_EQ(Encoder::encode(samplePointers.begin(), samplePointers.end(), &Sample::latitude, &Sample::longitude),
+              "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+
+    // Bidirectional and input iterators, the latter are not measured in advance.
+    std::list<Sample> samples;
+    std::stringstream stream;
+    for (int i = 0; i < 200; ++i) {
+        samples.push_back(Sample{ i * 0.4 - 40.0, i * 0.75 - 75.0 });
+        stream << samples.back().latitude << ' ' << samples.back().longitude << ' ';
+    }
+    const auto encoded = Encoder::encode(samples.begin(), samples.end(), &Sample::latitude, &Sample::longitude);
+    EXPECT_EQ(Encoder::decode(encoded).size(), 200);
+
+    std::string result = "prefix:";
+    Encoder::encode(std::istream_iterator<Sample>(stream), std::istream_iterator<Sample>(),
+                    &Sample::latitude, &Sample::longitude, result);
+    EXPECT_EQ(result, "prefix:" + encoded);
+
+    std::string buffer;
+    Encoder::encode(samples.begin(), samples.end(), &Sample::latitude, &Sample::longitude,
+                    std::back_inserter(buffer));
+    EXPECT_EQ(buffer, encoded);
+}
+
+TEST(General, EncodeAppend)
+{
+    gepaf::PolylineEncoder<> encoder;
+    encoder.addPoint(38.5, -120.2);
+    encoder.addPoint(40.7, -120.95);
+    encoder.addPoint(43.252, -126.453);
+
+    std::string result = "prefix:";
+    gepaf::PolylineEncoder<>::encode(encoder.polyline(), result);
+    EXPECT_EQ(result, "prefix:_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+
+    // Reusing the buffer does not allocate.
+    result.clear();
+    const auto capacity = result.capacity();
+    const auto data = result.data();
+    gepaf::PolylineEncoder<>::encode(encoder.polyline(), result);
+    EXPECT_EQ(result, "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+    EXPECT_EQ(result.capacity(), capacity);
+    EXPECT_EQ(result.data(), data);
+
+    // Encoding of an empty polyline leaves the string untouched.
+    gepaf::PolylineEncoder<>::encode(gepaf::PolylineEncoder<>::Polyline(), result);
+    EXPECT_EQ(result, "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+}
+
+TEST(General, EncodeReserved)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    // The longest values: the points jump between the opposite corners.
+    Encoder::PolylineE5 polyline;
+    for (int i = 0; i < 1000; ++i) {
+        polyline.push_back(i % 2 ? Encoder::PointE5{ 9000000, 18000000 } : Encoder::PointE5{ -9000000, -18000000 });
+    }
+    Encoder::Polyline points;
+    for (const auto &point : polyline) {
+        points.push_back(Encoder::Point::fromE5(point.latitude, point.longitude));
+    }
+    const auto expected = Encoder::encodeE5(polyline);
+    EXPECT_EQ(expected.size(), Encoder::maxEncodedSize(polyline.size()) - 1); // The first point is shorter.
+
+    // The string with the documented capacity reserved is never reallocated.
+    const auto expectInPlace = [&](const std::function<void(std::string &)> &encode) {
+        std::string result;
+        result.reserve(Encoder::maxEncodedSize(polyline.size()));
+        const auto data = result.data();
+        encode(result);
+        EXPECT_EQ(result, expected);
+        EXPECT_EQ(result.data(), data);
+    };
+    expectInPlace([&](std::string &result) { Encoder::encodeE5(polyline, result); });
+    expectInPlace([&](std::string &result) { Encoder::encode(points, result); });
+    expectInPlace([&](std::string &result) {
+        Encoder::encode(polyline.begin(), polyline.end(),
+                        [](const Encoder::PointE5 &point) { return Encoder::fromE5(point.latitude); },
+                        [](const Encoder::PointE5 &point) { return Encoder::fromE5(point.longitude); }, result);
+    });
+
+    // Coordinates out of range take more characters, the string grows.
+    Encoder::PolylineE5 outOfRange(100, Encoder::PointE5{ 0, 0 });
+    for (size_t i = 0; i < outOfRange.size(); i += 2) {
+        outOfRange[i] = Encoder::PointE5{ INT32_MIN, INT32_MIN };
+    }
+    std::string result;
+    result.reserve(Encoder::maxEncodedSize(outOfRange.size()));
+    Encoder::encodeE5(outOfRange, result);
+    EXPECT_EQ(result.size(), 100 * 2 * 7);
+    EXPECT_EQ(result, Encoder::encodeE5(outOfRange));
+}
+
+TEST(FixedPoint, EncodeDecode)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    const Encoder::PolylineE5 polyline = {
+        { 3850000, -12020000 },
+        { 4070000, -12095000 },
+        { 4325200, -12645300 }
+    };
+    EXPECT_EQ(Encoder::encodeE5(polyline), "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+
+    auto decoded = Encoder::decodeE5("_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+    ASSERT_EQ(decoded.size(), 3);
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        EXPECT_EQ(decoded[i].latitude, polyline[i].latitude);
+        EXPECT_EQ(decoded[i].longitude, polyline[i].longitude);
+    }
+
+    EXPECT_EQ(Encoder::decodeE5("_p~iF~ps|U_ulLnnqC_mqNvxq`").size(), 0);
+    EXPECT_EQ(Encoder::decodeE5("").size(), 0);
+}
+
+TEST(FixedPoint, Conversion)
+{
+    EXPECT_EQ(gepaf::PolylineEncoder<>::toE5(38.5), 3850000);
+    EXPECT_EQ(gepaf::PolylineEncoder<>::toE5(-120.000004), -12000000);
+    EXPECT_EQ(gepaf::PolylineEncoder<6>::toE5(-120.0000045), -120000005);
+    EXPECT_DOUBLE_EQ(gepaf::PolylineEncoder<>::fromE5(-12645300), -126.453);
+
+    auto point = gepaf::PolylineEncoder<>::Point::fromE5(4325200, -12645300);
+    EXPECT_TRUE(point == gepaf::PolylineEncoder<>::Point(43.252, -126.453));
+}
+
+TEST(FixedPoint, NoRoundingDrift)
+{
+    // Small steps that round to zero must not accumulate.
+    gepaf::PolylineEncoder<> encoder;
+    for (int i = 0; i < 1000; ++i) {
+        encoder.addPoint(10.0 + i * 0.0000049, 20.0 - i * 0.0000049);
+    }
+    auto decoded = gepaf::PolylineEncoder<>::decode(encoder.encode());
+    ASSERT_EQ(decoded.size(), 1000);
+    EXPECT_TRUE(decoded.back() == encoder.polyline().back());
+
+    // A tiny negative offset is encoded as zero.
+    struct Raw { double lat; double lon; };
+    Raw raw[] = { { 1.0, 1.0 }, { 0.999999, 0.999999 } };
+    EXPECT_EQ(gepaf::PolylineEncoder<>::encode(raw, raw + 2, &Raw::lat, &Raw::lon), "_ibE_ibE??");
+}
+
+TEST(FixedPoint, SevenDigits)
+{
+    // Longitude offsets of 360° do not fit into 32-bit values with 7 digits.
+    gepaf::PolylineEncoder<7> encoder;
+    encoder.addPoint(-45.0, -180.0);
+    encoder.addPoint(45.0, 180.0);
+    encoder.addPoint(-45.0, -180.0);
+
+    auto decoded = gepaf::PolylineEncoder<7>::decode(encoder.encode());
+    ASSERT_EQ(decoded.size(), 3);
+    EXPECT_TRUE(decoded[0] == gepaf::PolylineEncoder<7>::Point(-45.0, -180.0));
+    EXPECT_TRUE(decoded[1] == gepaf::PolylineEncoder<7>::Point(45.0, 180.0));
+    EXPECT_TRUE(decoded[2] == gepaf::PolylineEncoder<7>::Point(-45.0, -180.0));
+}
+
+template<int Digits>
+void testBatchEncoder(std::mt19937 &generator, int32_t minValue, int32_t maxValue)
+{
+    using Encoder = gepaf::PolylineEncoder<Digits>;
+
+    std::uniform_int_distribution<int32_t> distribution(minValue, maxValue);
+    for (size_t size : { 0, 1, 7, 8, 9, 100 }) {
+        typename Encoder::PolylineE5 polyline;
+        for (size_t i = 0; i < size; ++i) {
+            polyline.push_back({ distribution(generator), distribution(generator) });
+        }
+
+        // The batch encoder must produce exactly the same output as the scalar one.
+        std::string scalar;
+        Encoder::encodeE5(polyline, std::back_inserter(scalar));
+        EXPECT_EQ(Encoder::encodeE5(polyline), scalar);
+    }
+}
+
+TEST(BatchEncoder, MatchesScalar)
+{
+    std::mt19937 generator(42);
+    testBatchEncoder<1>(generator, -1800, 1800);
+    testBatchEncoder<5>(generator, -18000000, 18000000);
+    testBatchEncoder<5>(generator, -20, 20);
+    testBatchEncoder<6>(generator, -180000000, 180000000);
+    testBatchEncoder<7>(generator, -1800000000, 1800000000);
+
+    // Any 32-bit values, even invalid coordinates.
+    testBatchEncoder<5>(generator, std::numeric_limits<int32_t>::min(),
+                        std::numeric_limits<int32_t>::max());
+}
+
+TEST(BatchEncoder, LongestValues)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+    const Encoder::PolylineE5 polyline = {
+        { std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::min() },
+        { 0, 0 }
+    };
+
+    std::string scalar;
+    Encoder::encodeE5(polyline, std::back_inserter(scalar));
+    EXPECT_EQ(scalar.size(), 28);
+    EXPECT_EQ(Encoder::encodeE5(polyline), scalar);
+}
+
+// The reference scalar decoder: one character at a time.
+template<int Digits>
+typename gepaf::PolylineEncoder<Digits>::PolylineE5 referenceDecode(const std::string &coords)
+{
+    typename gepaf::PolylineEncoder<Digits>::PolylineE5 polyline;
+    const int64_t bounds[] = { 90LL * gepaf::PolylineEncoder<Digits>::Precision::Value,
+                               180LL * gepaf::PolylineEncoder<Digits>::Precision::Value };
+    uint32_t sums[2] = { 0, 0 };
+    size_t i = 0;
+    while (i < coords.size()) {
+        for (int j = 0; j < 2; ++j) {
+            uint64_t result = 0;
+            int shift = 0;
+            int c = 0;
+            do {
+                if (i == coords.size() || shift > 30) {
+                    return {};
+                }
+                c = static_cast<unsigned char>(coords[i++]) - 63;
+                if (c < 0 || c > 63) {
+                    return {};
+                }
+                result |= static_cast<uint64_t>(c & 0x1f) << shift;
+                shift += 5;
+            } while (c >= 0x20);
+
+            if (result > std::numeric_limits<uint32_t>::max()) {
+                return {};
+            }
+            const int32_t delta = (result & 1) ? ~static_cast<int32_t>(result >> 1)
+                                               : static_cast<int32_t>(result >> 1);
+            sums[j] += static_cast<uint32_t>(delta);
+            if (static_cast<int32_t>(sums[j]) > bounds[j] || static_cast<int32_t>(sums[j]) < -bounds[j]) {
+                return {};
+            }
+        }
+        polyline.push_back({ static_cast<int32_t>(sums[0]), static_cast<int32_t>(sums[1]) });
+    }
+    return polyline;
+}
+
+template<int Digits>
+void expectSameDecoding(const std::string &coords)
+{
+    const auto expected = referenceDecode<Digits>(coords);
+    const auto decoded = gepaf::PolylineEncoder<Digits>::decodeE5(coords);
+    ASSERT_EQ(decoded.size(), expected.size()) << coords;
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        EXPECT_EQ(decoded[i].latitude, expected[i].latitude);
+        EXPECT_EQ(decoded[i].longitude, expected[i].longitude);
+    }
+}
+
+TEST(WordDecoder, MatchesScalar)
+{
+    std::mt19937 generator(7);
+
+    // Valid polylines with values of all sizes, from -2^26 up to 2^31 - 2^26.
+    std::uniform_int_distribution<int> shifts(1, 28);
+    const auto value = [&] {
+        const int64_t bits = generator() >> shifts(generator);
+        return static_cast<int32_t>(bits - (int64_t{ 1 } << 26));
+    };
+    for (int n = 0; n < 200; ++n) {
+        gepaf::PolylineEncoder<7>::PolylineE5 polyline;
+        for (int i = 0; i < n; ++i) {
+            polyline.push_back({ value(), value() });
+        }
+        const auto encoded = gepaf::PolylineEncoder<7>::encodeE5(polyline);
+        expectSameDecoding<7>(encoded);
+        expectSameDecoding<5>(encoded);
+
+        // Truncated polylines.
+        if (!encoded.empty()) {
+            expectSameDecoding<7>(encoded.substr(0, generator() % encoded.size()));
+        }
+    }
+
+    // Random characters, valid and invalid ones.
+    std::uniform_int_distribution<int> valid('?', '~');
+    std::uniform_int_distribution<int> any(0, 255);
+    for (int n = 0; n < 500; ++n) {
+        std::string coords;
+        for (int i = 0; i < n % 40; ++i) {
+            coords += static_cast<char>(n % 3 ? valid(generator) : any(generator));
+        }
+        expectSameDecoding<5>(coords);
+        expectSameDecoding<7>(coords);
+    }
+
+    // Values that do not fit into 32 bits.
+    expectSameDecoding<7>("~~~~~~~?????????");
+    expectSameDecoding<7>("~~~~~~~~????????");
+}
+
+TEST(StreamingDecoder, ArbitraryChunks)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    Encoder encoder;
+    for (int i = 0; i < 50; ++i) {
+        encoder.addPoint(38.5 + i * 0.0123, -120.2 - i * i * 0.00071);
+    }
+    const auto encoded = encoder.encode();
+    const auto expected = Encoder::decode(encoded);
+
+    // Split the input at every possible position into chunks of various sizes.
+    for (size_t chunkSize = 1; chunkSize < 20; ++chunkSize) {
+        gepaf::PolylineDecoder<> decoder;
+        Encoder::Polyline decoded;
+        for (size_t i = 0; i < encoded.size(); i += chunkSize) {
+            EXPECT_TRUE(decoder.decode(encoded.substr(i, chunkSize), [&decoded](const Encoder::Point &point) {
+                decoded.push_back(point);
+            }));
+        }
+        EXPECT_TRUE(decoder.isComplete());
+        EXPECT_EQ(decoder.pointCount(), expected.size());
+        ASSERT_EQ(decoded.size(), expected.size());
+        for (size_t i = 0; i < decoded.size(); ++i) {
+            EXPECT_TRUE(decoded[i] == expected[i]);
+        }
+    }
+}
+
+TEST(StreamingDecoder, PointsAreEmittedEarly)
+{
+    gepaf::PolylineDecoder<> decoder;
+    std::vector<gepaf::PolylineDecoder<>::PointE5> points;
+    auto emit = [&points](const gepaf::PolylineDecoder<>::PointE5 &point) { points.push_back(point); };
+
+    EXPECT_TRUE(decoder.decodeE5("_p~iF~ps|U_ul", 13, emit));
+    ASSERT_EQ(points.size(), 1);
+    EXPECT_EQ(points[0].latitude, 3850000);
+    EXPECT_EQ(points[0].longitude, -12020000);
+    EXPECT_FALSE(decoder.isComplete());
+
+    EXPECT_TRUE(decoder.decodeE5("LnnqC_mqNvxq`@", 14, emit));
+    ASSERT_EQ(points.size(), 3);
+    EXPECT_EQ(points[2].latitude, 4325200);
+    EXPECT_EQ(points[2].longitude, -12645300);
+    EXPECT_TRUE(decoder.isComplete());
+}
+
+TEST(StreamingDecoder, InvalidInput)
+{
+    auto ignore = [](const gepaf::PolylineDecoder<>::Point &) {};
+
+    // Truncated string.
+    gepaf::PolylineDecoder<> decoder;
+    EXPECT_TRUE(decoder.decode("_p~iF~ps|U_ulLnnqC_mqNvxq`", ignore));
+    EXPECT_FALSE(decoder.isComplete());
+    EXPECT_FALSE(decoder.hasFailed());
+
+    // Extremely large longitude.
+    decoder.reset();
+    EXPECT_FALSE(decoder.decode("_p~iF~ps|u_ulLnnq", ignore));
+    EXPECT_TRUE(decoder.hasFailed());
+    EXPECT_FALSE(decoder.decode("C_mqNvxq`@", ignore));
+    EXPECT_FALSE(decoder.isComplete());
+
+    decoder.reset();
+    EXPECT_TRUE(decoder.decode("_p~iF~ps|U_ulLnnqC_mqNvxq`@", ignore));
+    EXPECT_TRUE(decoder.isComplete());
+    EXPECT_EQ(decoder.pointCount(), 3);
+}
+
+TEST(View, Iterate)
+{
+    const std::string coords = "_p~iF~ps|U_ulLnnqC_mqNvxq`@";
+    gepaf::PolylineView<> view(coords);
+
+    EXPECT_FALSE(view.empty());
+    EXPECT_EQ(view.count(), 3);
+    EXPECT_EQ(std::distance(view.begin(), view.end()), 3);
+
+    auto it = view.begin();
+    EXPECT_TRUE(*it == gepaf::PolylineEncoder<>::Point(38.5, -120.2));
+    EXPECT_EQ(it->latitude(), 38.5);
+    ++it;
+    EXPECT_TRUE(*it == gepaf::PolylineEncoder<>::Point(40.7, -120.95));
+    EXPECT_EQ(it.e5().latitude, 4070000);
+    EXPECT_EQ(it.e5().longitude, -12095000);
+    auto copy = it++;
+    EXPECT_TRUE(*copy == gepaf::PolylineEncoder<>::Point(40.7, -120.95));
+    EXPECT_TRUE(*it == gepaf::PolylineEncoder<>::Point(43.252, -126.453));
+    EXPECT_TRUE(++it == view.end());
+
+    EXPECT_TRUE(view.front() == gepaf::PolylineEncoder<>::Point(38.5, -120.2));
+    EXPECT_TRUE(view.back() == gepaf::PolylineEncoder<>::Point(43.252, -126.453));
+
+    // Scan until the condition is met.
+    auto found = std::find_if(view.begin(), view.end(), [](const gepaf::PolylineEncoder<>::Point &point) {
+        return point.longitude() < -120.5;
+    });
+    ASSERT_TRUE(found != view.end());
+    EXPECT_EQ(found->latitude(), 40.7);
+
+    // The points are values, they outlive the iterators and equal iterators yield equal points.
+    const gepaf::PolylineEncoder<>::Point &first = *view.begin();
+    auto second = view.begin();
+    ++second;
+    EXPECT_TRUE(first == gepaf::PolylineEncoder<>::Point(38.5, -120.2));
+    EXPECT_TRUE(*second == *std::next(view.begin()));
+    using Traits = std::iterator_traits<gepaf::PolylineView<>::Iterator>;
+    static_assert(!std::is_reference<Traits::reference>::value,
+                  "The points must be returned by value");
+    static_assert(std::is_same<Traits::iterator_category, std::input_iterator_tag>::value,
+                  "Without references to the points the iterator is an input iterator");
+    static_assert(std::is_same<Traits::value_type, gepaf::PolylineEncoder<>::Point>::value &&
+                  std::is_same<Traits::reference, gepaf::PolylineEncoder<>::Point>::value,
+                  "The points must be the values and the references");
+    static_assert(std::is_same<decltype(view.begin().operator->().operator->()),
+                               const gepaf::PolylineEncoder<>::Point *>::value,
+                  "The member access must reach the point");
+}
+
+TEST(View, EmptyAndInvalid)
+{
+    gepaf::PolylineView<> empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.count(), 0);
+    EXPECT_TRUE(empty.begin() == empty.end());
+
+    // The iteration stops at the first invalid point.
+    const std::string coords = "_p~iF~ps|U_ulLnnqC_mqNvxq`";
+    gepaf::PolylineView<> view(coords.data(), coords.size());
+    EXPECT_EQ(std::distance(view.begin(), view.end()), 2);
+    EXPECT_TRUE(view.back() == gepaf::PolylineEncoder<>::Point(40.7, -120.95));
+}
+
+#ifdef POLYLINEENCODER_CXX17
+TEST(View, StringView)
+{
+    using namespace std::literals;
+
+    gepaf::PolylineView<> view("_p~iF~ps|U_ulLnnqC_mqNvxq`@"sv);
+    EXPECT_EQ(view.count(), 3);
+    EXPECT_TRUE(view.back() == gepaf::PolylineEncoder<>::Point(43.252, -126.453));
+}
+#endif
+
+TEST(Batch, ThreadPool)
+{
+    for (size_t threads : { 1, 2, 4 }) {
+        gepaf::ThreadPool pool(threads);
+        EXPECT_EQ(pool.threadCount(), threads);
+
+        // Each item is processed exactly once.
+        std::vector<int> counters(10007, 0);
+        for (int run = 0; run < 3; ++run) {
+            pool.parallelFor(counters.size(), [&counters](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    ++counters[i];
+                }
+            });
+        }
+        EXPECT_TRUE(std::all_of(counters.begin(), counters.end(), [](int c) { return c == 3; }));
+
+        pool.parallelFor(0, [](size_t, size_t) { FAIL(); });
+    }
+}
+
+TEST(Batch, EncodeDecode)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<double> step(-0.01, 0.01);
+    std::vector<Encoder::Polyline> polylines(500);
+    for (size_t i = 0; i < polylines.size(); ++i) {
+        double lat = 40.0;
+        double lon = -120.0;
+        for (size_t j = 0; j < i % 37; ++j) {
+            polylines[i].emplace_back(lat += step(generator), lon += step(generator));
+        }
+    }
+
+    for (size_t threads : { 1, 3 }) {
+        gepaf::ThreadPool pool(threads);
+
+        auto encoded = gepaf::PolylineBatch<>::encode(polylines.begin(), polylines.end(), pool);
+        ASSERT_EQ(encoded.size(), polylines.size());
+        std::vector<std::string> strings;
+        for (size_t i = 0; i < polylines.size(); ++i) {
+            strings.push_back(encoded.at(i));
+            EXPECT_EQ(strings.back(), Encoder::encode(polylines[i]));
+            EXPECT_EQ(encoded.view(i).count(), polylines[i].size());
+        }
+
+        // Make some polylines invalid.
+        strings[5].pop_back();
+        strings[100] = "_p~if~ps|U";
+
+        auto decoded = gepaf::PolylineBatch<>::decode(strings.begin(), strings.end(), pool);
+        ASSERT_EQ(decoded.size(), polylines.size());
+        for (size_t i = 0; i < polylines.size(); ++i) {
+            const auto expected = Encoder::decode(strings[i]);
+            const auto polyline = decoded.at(i);
+            ASSERT_EQ(polyline.size(), expected.size());
+            EXPECT_EQ(decoded.end(i) - decoded.begin(i), static_cast<ptrdiff_t>(expected.size()));
+            for (size_t j = 0; j < expected.size(); ++j) {
+                EXPECT_TRUE(polyline[j] == expected[j]);
+            }
+        }
+        EXPECT_EQ(decoded.at(5).size(), 0);
+        EXPECT_EQ(decoded.at(100).size(), 0);
+    }
+}
+
+TEST(Batch, Empty)
+{
+    gepaf::ThreadPool pool(2);
+    std::vector<gepaf::PolylineEncoder<>::Polyline> polylines(3);
+    auto encoded = gepaf::PolylineBatch<>::encode(polylines.begin(), polylines.end(), pool);
+    EXPECT_EQ(encoded.size(), 3);
+    EXPECT_TRUE(encoded.data.empty());
+
+    std::vector<std::string> strings;
+    auto decoded = gepaf::PolylineBatch<>::decode(strings.begin(), strings.end(), pool);
+    EXPECT_EQ(decoded.size(), 0);
+    EXPECT_TRUE(decoded.points.empty());
+}
+
+TEST(Batch, DecodeParallel)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    // A long random walk with the values of various sizes.
+    std::mt19937 generator(11);
+    std::uniform_int_distribution<int> shifts(0, 20);
+    Encoder::PolylineE5 walk;
+    int32_t lat = 0;
+    int32_t lon = 0;
+    for (int i = 0; i < 100000; ++i) {
+        lat = std::max(-9000000, std::min(9000000, lat + static_cast<int32_t>(generator() >> (12 + shifts(generator))) - 4096));
+        lon = std::max(-18000000, std::min(18000000, lon + static_cast<int32_t>(generator() >> (12 + shifts(generator))) - 4096));
+        walk.push_back({ lat, lon });
+    }
+    const auto encoded = Encoder::encodeE5(walk);
+    ASSERT_GT(encoded.size(), 1U << 16);
+
+    for (size_t threads : { 1, 2, 3, 8 }) {
+        gepaf::ThreadPool pool(threads);
+        const auto decoded = gepaf::PolylineBatch<>::decodeParallel(encoded, pool);
+        ASSERT_EQ(decoded.size(), walk.size());
+        for (size_t i = 0; i < walk.size(); ++i) {
+            ASSERT_EQ(Encoder::toE5(decoded[i].latitude()), walk[i].latitude);
+            ASSERT_EQ(Encoder::toE5(decoded[i].longitude()), walk[i].longitude);
+        }
+
+        // Invalid strings are decoded as empty polylines.
+        EXPECT_EQ(gepaf::PolylineBatch<>::decodeParallel(encoded.substr(0, encoded.size() - 1), pool).size(), 0);
+        auto corrupted = encoded;
+        corrupted[corrupted.size() / 2] = '~';
+        EXPECT_EQ(gepaf::PolylineBatch<>::decodeParallel(corrupted, pool).size(),
+                  Encoder::decode(corrupted).size());
+
+        // Short strings.
+        EXPECT_EQ(gepaf::PolylineBatch<>::decodeParallel("_p~iF~ps|U_ulLnnqC_mqNvxq`@", pool).size(), 3);
+    }
+}
+
+TEST(Columns, EncodeDecode)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    const double latitudes[] = { 38.5, 40.7, 43.252 };
+    const double longitudes[] = { -120.2, -120.95, -126.453 };
+    EXPECT_EQ(Encoder::encodeColumns(latitudes, longitudes, 3), "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+
+    const int32_t latitudesE5[] = { 3850000, 4070000, 4325200 };
+    const int32_t longitudesE5[] = { -12020000, -12095000, -12645300 };
+    std::string result = "prefix:";
+    Encoder::encodeColumnsE5(latitudesE5, longitudesE5, 3, result);
+    EXPECT_EQ(result, "prefix:_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+
+    const auto columns = Encoder::decodeColumns("_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+    ASSERT_EQ(columns.latitudes.size(), 3);
+    ASSERT_EQ(columns.longitudes.size(), 3);
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_DOUBLE_EQ(columns.latitudes[i], latitudes[i]);
+        EXPECT_DOUBLE_EQ(columns.longitudes[i], longitudes[i]);
+    }
+
+    const auto columnsE5 = Encoder::decodeColumnsE5("_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+    ASSERT_EQ(columnsE5.latitudes.size(), 3);
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(columnsE5.latitudes[i], latitudesE5[i]);
+        EXPECT_EQ(columnsE5.longitudes[i], longitudesE5[i]);
+    }
+
+    // Invalid and empty strings.
+    EXPECT_TRUE(Encoder::decodeColumns("_p~iF~ps|U_ulLnnqC_mqNvxq`").latitudes.empty());
+    EXPECT_TRUE(Encoder::decodeColumnsE5("").longitudes.empty());
+    EXPECT_EQ(Encoder::encodeColumns(nullptr, nullptr, 0), "");
+}
+
+TEST(Columns, MatchesPoints)
+{
+    using Encoder = gepaf::PolylineEncoder<6>;
+
+    std::mt19937 generator(5);
+    std::uniform_real_distribution<double> lat(-90.0, 90.0);
+    std::uniform_real_distribution<double> lon(-180.0, 180.0);
+
+    Encoder::Columns columns;
+    Encoder::Polyline polyline;
+    for (int i = 0; i < 1000; ++i) {
+        columns.latitudes.push_back(lat(generator));
+        columns.longitudes.push_back(lon(generator));
+        polyline.emplace_back(columns.latitudes.back(), columns.longitudes.back());
+    }
+
+    const auto encoded = Encoder::encodeColumns(columns.latitudes.data(), columns.longitudes.data(), 1000);
+    EXPECT_EQ(encoded, Encoder::encode(polyline));
+
+    const auto decoded = Encoder::decodeColumns(encoded);
+    ASSERT_EQ(decoded.latitudes.size(), 1000);
+    for (size_t i = 0; i < polyline.size(); ++i) {
+        EXPECT_EQ(decoded.latitudes[i], polyline[i].latitude());
+        EXPECT_EQ(decoded.longitudes[i], polyline[i].longitude());
+    }
+}
+
+TEST(Validation, ErrorPositions)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+    using Status = Encoder::Status;
+
+    const auto expectResult = [](const std::string &coords, Status status, size_t position, size_t count) {
+        const auto result = Encoder::validate(coords);
+        EXPECT_EQ(result.status, status) << coords;
+        EXPECT_EQ(result.position, position) << coords;
+        EXPECT_EQ(result.pointCount, count) << coords;
+        EXPECT_EQ(static_cast<bool>(result), status == Status::Ok);
+    };
+
+    expectResult("", Status::Ok, 0, 0);
+    expectResult("_p~iF~ps|U_ulLnnqC_mqNvxq`@", Status::Ok, 27, 3);
+
+    // Truncated values and points.
+    expectResult("_p~iF~ps|U_ulLnnqC_mqNvxq", Status::Incomplete, 22, 2);
+    expectResult("_p~iF~ps|U_ulL", Status::Incomplete, 14, 1);
+    expectResult("_p~iF~ps|U_ul", Status::Incomplete, 10, 1);
+
+    // Characters out of the ['?', '~'] range.
+    expectResult("_p~iF~ps|U _ulLnnqC", Status::InvalidCharacter, 10, 1);
+    expectResult("_p~iF~ps|U_ulLnnqC\x7f", Status::InvalidCharacter, 18, 2);
+    expectResult("_p~iF~ps|U_u\xff", Status::InvalidCharacter, 12, 1);
+
+    // Values longer than 32 bits, both in the word and in the scalar decoding.
+    expectResult("~~~~~~C??", Status::Overflow, 6, 0);
+    expectResult("_p~iF~ps|U~~~~~~~?", Status::Overflow, 16, 1);
+    expectResult("~~~~~~B?", Status::OutOfRange, 0, 0);
+
+    // Coordinates out of range, even if the offsets are not.
+    const auto outOfRange = Encoder::encodeE5({ { 4500000, 9000000 }, { 8000000, 17000000 },
+                                                { 9000001, 17000000 }, { 0, 0 } });
+    const auto second = Encoder::encodeE5({ { 4500000, 9000000 }, { 8000000, 17000000 } }).size();
+    expectResult(outOfRange, Status::OutOfRange, second, 2);
+    expectResult(Encoder::encodeE5({ { 0, -18000001 } }), Status::OutOfRange, 0, 0);
+}
+
+TEST(Validation, DecodeKeepsPoints)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    // The decoding appends the points before the error.
+    Encoder::Polyline polyline = { Encoder::Point(1.0, 2.0) };
+    const auto result = Encoder::decode("_p~iF~ps|U_ulLnnqC_mqNvxq", polyline);
+    EXPECT_EQ(result.status, Encoder::Status::Incomplete);
+    EXPECT_EQ(result.position, 22);
+    ASSERT_EQ(polyline.size(), 3);
+    EXPECT_EQ(polyline[1].latitude(), 38.5);
+    EXPECT_EQ(polyline[2].longitude(), -120.95);
+
+    Encoder::PolylineE5 polylineE5;
+    EXPECT_TRUE(Encoder::decodeE5("_p~iF~ps|U_ulLnnqC_mqNvxq`@", polylineE5));
+    ASSERT_EQ(polylineE5.size(), 3);
+    EXPECT_EQ(polylineE5[2].latitude, 4325200);
+
+    // The all-or-nothing decoding.
+    EXPECT_TRUE(Encoder::decode("_p~iF~ps|U_ulLnnqC_mqNvxq").empty());
+}
+
+TEST(Validation, LongOffsets)
+{
+    // Offsets longer than 90° and 180° between valid coordinates.
+    using Encoder = gepaf::PolylineEncoder<>;
+    const Encoder::Polyline polyline = { Encoder::Point(-80.0, -170.0), Encoder::Point(80.0, 170.0),
+                                         Encoder::Point(-90.0, -180.0), Encoder::Point(90.0, 180.0) };
+    const auto encoded = Encoder::encode(polyline);
+    EXPECT_TRUE(Encoder::validate(encoded));
+
+    const auto decoded = Encoder::decode(encoded);
+    ASSERT_EQ(decoded.size(), polyline.size());
+    for (size_t i = 0; i < polyline.size(); ++i) {
+        EXPECT_EQ(decoded[i].latitude(), polyline[i].latitude());
+        EXPECT_EQ(decoded[i].longitude(), polyline[i].longitude());
+    }
+
+    gepaf::PolylineView<> view(encoded);
+    EXPECT_EQ(std::distance(view.begin(), view.end()), 4);
+
+    gepaf::PolylineDecoder<> decoder;
+    size_t count = 0;
+    EXPECT_TRUE(decoder.decode(encoded, [&count](const Encoder::Point &) { ++count; }));
+    EXPECT_EQ(count, 4);
+}
+
+TEST(File, WriteRead)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+    const std::string path = testing::TempDir() + "polylines.txt";
+
+    const Encoder::Polyline polyline = { { 38.5, -120.2 }, { 40.7, -120.95 }, { 43.252, -126.453 } };
+    {
+        // A small buffer to flush in between.
+        gepaf::PolylineWriter<> writer;
+        ASSERT_TRUE(writer.open(path, 16));
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_TRUE(writer.write(polyline));
+        }
+        EXPECT_TRUE(writer.write(Encoder::PolylineE5{}));
+        EXPECT_TRUE(writer.write("_p~i", 4));
+        EXPECT_TRUE(writer.close());
+    }
+
+    gepaf::PolylineReader<> reader;
+    ASSERT_TRUE(reader.open(path));
+
+    Encoder::Polyline points;
+    Encoder::Result result{};
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(reader.next(points, result));
+        EXPECT_TRUE(result);
+        ASSERT_EQ(points.size(), 3);
+        EXPECT_EQ(points[2].latitude(), 43.252);
+    }
+
+    // The empty and the invalid records.
+    ASSERT_TRUE(reader.next(points, result));
+    EXPECT_TRUE(result);
+    EXPECT_TRUE(points.empty());
+    ASSERT_TRUE(reader.next(points, result));
+    EXPECT_EQ(result.status, Encoder::Status::Incomplete);
+    EXPECT_EQ(reader.lineNumber(), 102);
+    EXPECT_FALSE(reader.next(points, result));
+
+    // The records without decoding.
+    reader.rewind();
+    gepaf::PolylineView<> record;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(std::string(record.data(), record.size()), "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+
+    std::remove(path.c_str());
+}
+
+TEST(File, Records)
+{
+    // Windows line endings, empty lines and no final line break.
+    const std::string data = "_p~iF~ps|U\r\n\n_ulLnnqC";
+    gepaf::PolylineReader<> reader(data.data(), data.size());
+
+    gepaf::PolylineEncoder<>::PolylineE5 points;
+    gepaf::PolylineEncoder<>::Result result{};
+    ASSERT_TRUE(reader.next(points, result));
+    ASSERT_EQ(points.size(), 1);
+    EXPECT_EQ(points[0].latitude, 3850000);
+    ASSERT_TRUE(reader.next(points, result));
+    EXPECT_TRUE(points.empty());
+    ASSERT_TRUE(reader.next(points, result));
+    ASSERT_EQ(points.size(), 1);
+    EXPECT_EQ(points[0].longitude, -75000);
+    EXPECT_FALSE(reader.next(points, result));
+
+    gepaf::PolylineReader<> missing;
+    EXPECT_FALSE(missing.open(testing::TempDir() + "no-such-file.txt"));
+    EXPECT_FALSE(missing.isOpen());
+    EXPECT_FALSE(missing.next(points, result));
+}
+
+TEST(Incremental, MatchesEncode)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    std::mt19937 generator(9);
+    std::uniform_real_distribution<double> lat(-90.0, 90.0);
+    std::uniform_real_distribution<double> lon(-180.0, 180.0);
+
+    Encoder encoder;
+    Encoder streaming(false);
+    Encoder::Polyline polyline;
+    for (int i = 0; i < 1000; ++i) {
+        polyline.emplace_back(lat(generator), lon(generator));
+        encoder.addPoint(polyline.back().latitude(), polyline.back().longitude());
+        streaming.addPointE5(Encoder::toE5(polyline.back().latitude()), Encoder::toE5(polyline.back().longitude()));
+
+        // The encoded polyline is up to date after each point.
+        if (i % 100 == 0) {
+            EXPECT_EQ(encoder.encoded(), Encoder::encode(polyline));
+        }
+    }
+    EXPECT_EQ(encoder.encode(), Encoder::encode(polyline));
+    EXPECT_EQ(streaming.encoded(), encoder.encoded());
+
+    EXPECT_EQ(encoder.polyline().size(), 1000);
+    EXPECT_EQ(encoder.pointCount(), 1000);
+    EXPECT_TRUE(streaming.polyline().empty());
+    EXPECT_EQ(streaming.pointCount(), 1000);
+
+    // Starts from the scratch after clearing.
+    streaming.clear();
+    EXPECT_TRUE(streaming.encoded().empty());
+    EXPECT_EQ(streaming.pointCount(), 0);
+    streaming.addPoint(38.5, -120.2);
+    EXPECT_EQ(streaming.encode(), "_p~iF~ps|U");
+}
+
+TEST(Edit, MatchesReencoding)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    std::mt19937 generator(13);
+    std::uniform_int_distribution<int32_t> lat(-9000000, 9000000);
+    std::uniform_int_distribution<int32_t> lon(-18000000, 18000000);
+    const auto makePolyline = [&](size_t size) {
+        Encoder::PolylineE5 polyline;
+        for (size_t i = 0; i < size; ++i) {
+            polyline.push_back({ lat(generator), lon(generator) });
+        }
+        return polyline;
+    };
+    const auto range = [](const Encoder::PolylineE5 &polyline, size_t begin, size_t end) {
+        return Encoder::PolylineE5(polyline.begin() + begin, polyline.begin() + end);
+    };
+
+    for (size_t size : { 0, 1, 2, 5, 20 }) {
+        const auto polyline = makePolyline(size);
+        const auto encoded = Encoder::encodeE5(polyline);
+        const auto other = makePolyline(3);
+
+        auto joined = polyline;
+        joined.insert(joined.end(), other.begin(), other.end());
+        EXPECT_EQ(Encoder::concat(encoded, Encoder::encodeE5(other)), Encoder::encodeE5(joined));
+        joined = other;
+        joined.insert(joined.end(), polyline.begin(), polyline.end());
+        EXPECT_EQ(Encoder::concat(Encoder::encodeE5(other), encoded), Encoder::encodeE5(joined));
+        EXPECT_EQ(Encoder::concat(encoded, ""), encoded);
+
+        for (size_t begin = 0; begin <= size; ++begin) {
+            for (size_t end = begin; end <= size + 1; ++end) {
+                const size_t clamped = std::min(end, size);
+                EXPECT_EQ(Encoder::slice(encoded, begin, end), Encoder::encodeE5(range(polyline, begin, clamped)));
+
+                auto spliced = range(polyline, 0, begin);
+                spliced.insert(spliced.end(), other.begin(), other.end());
+                spliced.insert(spliced.end(), polyline.begin() + clamped, polyline.end());
+                EXPECT_EQ(Encoder::splice(encoded, begin, end, Encoder::encodeE5(other)), Encoder::encodeE5(spliced));
+
+                auto removed = range(polyline, 0, begin);
+                removed.insert(removed.end(), polyline.begin() + clamped, polyline.end());
+                EXPECT_EQ(Encoder::splice(encoded, begin, end, ""), Encoder::encodeE5(removed));
+            }
+        }
+    }
+
+    // Invalid polylines.
+    EXPECT_EQ(Encoder::concat("_p~iF~ps|U_ul", "_p~iF~ps|U"), "");
+    EXPECT_EQ(Encoder::concat("_p~iF~ps|U", "_p~i"), "");
+    EXPECT_EQ(Encoder::slice("_p~i", 0, 1), "");
+    EXPECT_EQ(Encoder::splice("_p~iF~ps|U", 0, 1, "_p~i"), "");
+
+    // Invalid points after the first re-encoded one are not copied through.
+    EXPECT_EQ(Encoder::concat("_p~iF~ps|U", "_p~iF~ps|U_ul"), "");
+    EXPECT_EQ(Encoder::concat("_p~iF~ps|U", "_p~iF~ps|U !!"), "");
+    EXPECT_EQ(Encoder::concat("_p~iF~ps|U", "_p~iF~ps|U_wemJ?"), ""); // 98.5 degrees latitude
+    EXPECT_EQ(Encoder::splice("_p~iF~ps|U_ulLnnqC_ul", 0, 1, ""), "");
+    EXPECT_EQ(Encoder::splice("_p~iF~ps|U_ulLnnqC !", 0, 1, "_ibE_seK"), "");
+    EXPECT_EQ(Encoder::slice("_p~iF~ps|U_ulLnnqC !", 0, 5), "");
+    EXPECT_EQ(Encoder::slice("_p~iF~ps|U_ulLnnqC_ul", 1, 3), "");
+    // The points after the range are not examined.
+    EXPECT_EQ(Encoder::slice("_p~iF~ps|U_ulLnnqC !", 0, 1), "_p~iF~ps|U");
+}
+
+TEST(Codec, MatchesEncoder)
+{
+    std::mt19937 generator(17);
+    std::uniform_real_distribution<double> lat(-90.0, 90.0);
+    std::uniform_real_distribution<double> lon(-180.0, 180.0);
+
+    std::vector<double> values;
+    gepaf::PolylineEncoder<4>::Polyline polyline4;
+    gepaf::PolylineEncoder<5>::Polyline polyline5;
+    gepaf::PolylineEncoder<7>::Polyline polyline7;
+    for (int i = 0; i < 500; ++i) {
+        values.push_back(lat(generator));
+        values.push_back(lon(generator));
+        polyline4.emplace_back(values[2 * i], values[2 * i + 1]);
+        polyline5.emplace_back(values[2 * i], values[2 * i + 1]);
+        polyline7.emplace_back(values[2 * i], values[2 * i + 1]);
+    }
+
+    // Both the specializations and the generic path.
+    EXPECT_EQ(gepaf::PolylineCodec(5).encode(values), gepaf::PolylineEncoder<5>::encode(polyline5));
+    EXPECT_EQ(gepaf::PolylineCodec(7).encode(values), gepaf::PolylineEncoder<7>::encode(polyline7));
+    EXPECT_EQ(gepaf::PolylineCodec(4).encode(values), gepaf::PolylineEncoder<4>::encode(polyline4));
+
+    const auto decoded = gepaf::PolylineCodec(4).decode(gepaf::PolylineEncoder<4>::encode(polyline4));
+    ASSERT_EQ(decoded.size(), values.size());
+    for (size_t i = 0; i < polyline4.size(); ++i) {
+        EXPECT_EQ(decoded[2 * i], polyline4[i].latitude());
+        EXPECT_EQ(decoded[2 * i + 1], polyline4[i].longitude());
+    }
+    EXPECT_EQ(gepaf::PolylineCodec(5).decode(gepaf::PolylineEncoder<5>::encode(polyline5)).size(), values.size());
+}
+
+TEST(Codec, ExtraDimensions)
+{
+    // Latitude, longitude, elevation in centimeters and time in seconds.
+    const gepaf::PolylineCodec codec(6, 4, 2, 0);
+    const std::vector<double> values = { 38.5, -120.2, 1520.25, 1700000000.0,
+                                         40.7, -120.95, 1498.5, 1700000010.0,
+                                         43.252, -126.453, -12.75, 1700000025.0 };
+    const auto encoded = codec.encode(values);
+    const auto decoded = codec.decode(encoded);
+    ASSERT_EQ(decoded.size(), values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        EXPECT_DOUBLE_EQ(decoded[i], values[i]);
+    }
+
+    // The parameters must match.
+    EXPECT_EQ(codec.dimensions(), 4);
+    EXPECT_EQ(codec.precision(), 6);
+    EXPECT_NE(gepaf::PolylineCodec(6, 3, 2).decode(encoded).size(), values.size());
+
+    // Incomplete points.
+    std::vector<double> partial;
+    EXPECT_FALSE(codec.decode(encoded.data(), encoded.size() - 1, partial));
+    EXPECT_EQ(partial.size(), 8);
+    EXPECT_TRUE(codec.decode(encoded.substr(0, encoded.size() - 1)).empty());
+}
+
+TEST(Aggregate, MatchesDecode)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    std::mt19937 generator(19);
+    std::uniform_int_distribution<int32_t> lat(-9000000, 9000000);
+    std::uniform_int_distribution<int32_t> lon(-18000000, 18000000);
+    Encoder::PolylineE5 polyline;
+    for (int i = 0; i < 1000; ++i) {
+        polyline.push_back({ lat(generator), lon(generator) });
+    }
+    const auto encoded = Encoder::encodeE5(polyline);
+
+    EXPECT_EQ(Encoder::pointCount(encoded), polyline.size());
+
+    Encoder::BoundingBox box{};
+    EXPECT_TRUE(Encoder::bbox(encoded, box));
+    for (const auto &point : polyline) {
+        EXPECT_LE(box.min.latitude, point.latitude);
+        EXPECT_LE(box.min.longitude, point.longitude);
+        EXPECT_GE(box.max.latitude, point.latitude);
+        EXPECT_GE(box.max.longitude, point.longitude);
+    }
+    EXPECT_TRUE(std::any_of(polyline.begin(), polyline.end(), [&box](const Encoder::PointE5 &point) {
+        return point.latitude == box.min.latitude;
+    }));
+    EXPECT_TRUE(std::any_of(polyline.begin(), polyline.end(), [&box](const Encoder::PointE5 &point) {
+        return point.longitude == box.max.longitude;
+    }));
+
+    Encoder::PointE5 first{};
+    Encoder::PointE5 last{};
+    const auto result = Encoder::firstLast(encoded, first, last);
+    EXPECT_TRUE(result);
+    EXPECT_EQ(result.pointCount, polyline.size());
+    EXPECT_EQ(first.latitude, polyline.front().latitude);
+    EXPECT_EQ(last.longitude, polyline.back().longitude);
+
+    // Empty and invalid polylines.
+    EXPECT_TRUE(Encoder::bbox("", box));
+    EXPECT_EQ(box.max.latitude, 0);
+    EXPECT_EQ(Encoder::firstLast("_p~iF~ps|U_ulLnnqC_mqN", first, last).status, Encoder::Status::Incomplete);
+    EXPECT_EQ(last.latitude, 4070000);
+}
+
+TEST(Aggregate, Length)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    // A degree of a meridian and a quarter of the equator.
+    double meters = 0.0;
+    EXPECT_TRUE(Encoder::lengthMeters(Encoder::encode({ { 0.0, 0.0 }, { 1.0, 0.0 } }), meters));
+    EXPECT_NEAR(meters, 111195.08, 0.01);
+    EXPECT_TRUE(Encoder::lengthMeters(Encoder::encode({ { 0.0, 0.0 }, { 0.0, 45.0 }, { 0.0, 90.0 } }), meters));
+    EXPECT_NEAR(meters, 10007557.2, 0.1);
+
+    EXPECT_TRUE(Encoder::lengthMeters("", meters));
+    EXPECT_EQ(meters, 0.0);
+    EXPECT_TRUE(Encoder::lengthMeters("_p~iF~ps|U", meters));
+    EXPECT_EQ(meters, 0.0);
+}
+
+// The allocator that counts the allocations made through it.
+template<typename T>
+struct CountingAllocator
+{
+    using value_type = T;
+
+    explicit CountingAllocator(size_t *count) : count(count) {}
+
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U> &other) : count(other.count) {}
+
+    T *allocate(size_t n)
+    {
+        ++*count;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, size_t n) { std::allocator<T>().deallocate(p, n); }
+
+    size_t *count;
+};
+
+template<typename T, typename U>
+bool operator==(const CountingAllocator<T> &l, const CountingAllocator<U> &r) { return l.count == r.count; }
+
+template<typename T, typename U>
+bool operator!=(const CountingAllocator<T> &l, const CountingAllocator<U> &r) { return l.count != r.count; }
+
+TEST(Allocator, Custom)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+    const std::string coords = "_p~iF~ps|U_ulLnnqC_mqNvxq`@";
+
+    size_t count = 0;
+    std::vector<Encoder::Point, CountingAllocator<Encoder::Point>> polyline{ CountingAllocator<Encoder::Point>(&count) };
+    EXPECT_TRUE(Encoder::decode(coords, polyline));
+    ASSERT_EQ(polyline.size(), 3);
+    EXPECT_DOUBLE_EQ(polyline[2].latitude(), 43.252);
+    EXPECT_DOUBLE_EQ(polyline[2].longitude(), -126.453);
+    EXPECT_GT(count, 0);
+
+    std::vector<Encoder::PointE5, CountingAllocator<Encoder::PointE5>> polylineE5{
+        CountingAllocator<Encoder::PointE5>(&count) };
+    EXPECT_EQ(Encoder::decodeE5(coords.data(), 15, polylineE5).status, Encoder::Status::Incomplete);
+    EXPECT_EQ(polylineE5.size(), 1);
+
+    count = 0;
+    Encoder::BasicString<CountingAllocator<char>> encoded{ CountingAllocator<char>(&count) };
+    Encoder::encode(Encoder::decode(coords), encoded);
+    EXPECT_EQ(std::string(encoded.c_str()), coords);
+    EXPECT_GT(count, 0);
+
+    encoded.clear();
+    Encoder::encodeE5(Encoder::decodeE5(coords), encoded);
+    Encoder::encodeSimplified(Encoder::decode(coords), 0.0, encoded);
+    EXPECT_EQ(std::string(encoded.c_str()), coords + coords);
+}
+
+#ifdef POLYLINEENCODER_PMR
+TEST(Allocator, Pmr)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+    const std::string coords = "_p~iF~ps|U_ulLnnqC_mqNvxq`@";
+
+    // Everything is allocated in the arena, the upstream resource throws.
+    char buffer[4096];
+    std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+
+    Encoder::PmrPolyline polyline(&arena);
+    EXPECT_TRUE(Encoder::decode(coords, polyline));
+    EXPECT_EQ(polyline.size(), 3);
+
+    Encoder::PmrPolylineE5 polylineE5(&arena);
+    EXPECT_TRUE(Encoder::decodeE5(coords, polylineE5));
+
+    Encoder::PmrString encoded(&arena);
+    Encoder::encodeColumnsE5(&polylineE5[0].latitude, &polylineE5[0].longitude, 0, encoded);
+    Encoder::encode(polyline.cbegin(), polyline.cend(), &Encoder::Point::latitude,
+                    &Encoder::Point::longitude, encoded);
+    EXPECT_EQ(std::string_view(encoded), coords);
+}
+#endif
+
+TEST(Binary, RoundTrip)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+    using Binary = gepaf::PolylineBinary<>;
+
+    std::mt19937 generator(17);
+    std::uniform_int_distribution<int32_t> latitudes(-9000000, 9000000);
+    std::uniform_int_distribution<int32_t> longitudes(-18000000, 18000000);
+
+    Encoder::PolylineE5 polyline;
+    for (int i = 0; i < 1000; ++i) {
+        polyline.push_back(Encoder::PointE5{ latitudes(generator), longitudes(generator) });
+    }
+    const auto encoded = Encoder::encodeE5(polyline);
+
+    for (auto mode : { Binary::Mode::Delta, Binary::Mode::DeltaOfDelta }) {
+        const auto binary = Binary::encodeE5(polyline, mode);
+        EXPECT_EQ(binary, Binary::fromPolyline(encoded, mode));
+        EXPECT_EQ(Binary::toPolyline(binary), encoded);
+
+        const auto decoded = Binary::decodeE5(binary);
+        ASSERT_EQ(decoded.size(), polyline.size());
+        for (size_t i = 0; i < polyline.size(); ++i) {
+            EXPECT_EQ(decoded[i].latitude, polyline[i].latitude);
+            EXPECT_EQ(decoded[i].longitude, polyline[i].longitude);
+        }
+
+        const auto empty = Binary::fromPolyline("", mode);
+        EXPECT_EQ(empty.size(), 1);
+        EXPECT_EQ(Binary::toPolyline(empty), "");
+    }
+
+    EXPECT_EQ(Binary::toPolyline(Binary::fromPolyline("_p~iF~ps|U_ulLnnqC_mqNvxq`@")), "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+}
+
+TEST(Binary, DeltaOfDelta)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+    using Binary = gepaf::PolylineBinary<>;
+
+    // A regularly sampled track of a vehicle, with the speed changing slowly.
+    Encoder::PolylineE5 polyline;
+    for (int32_t i = 0; i < 1000; ++i) {
+        polyline.push_back(Encoder::PointE5{ 4720000 + 150 * i + (i * i) / 100, 1660000 - 230 * i + i % 3 });
+    }
+    const auto encoded = Encoder::encodeE5(polyline);
+    const auto delta = Binary::encodeE5(polyline, Binary::Mode::Delta);
+    const auto deltaOfDelta = Binary::encodeE5(polyline, Binary::Mode::DeltaOfDelta);
+
+    EXPECT_LT(delta.size(), encoded.size());
+    EXPECT_LT(deltaOfDelta.size(), delta.size());
+    EXPECT_EQ(Binary::toPolyline(deltaOfDelta), encoded);
+}
+
+TEST(Binary, Errors)
+{
+    using Binary = gepaf::PolylineBinary<>;
+    using Status = Binary::Status;
+
+    const auto expectResult = [](const std::string &binary, Status status, size_t position, size_t count) {
+        Binary::PolylineE5 polyline;
+        const auto result = Binary::decodeE5(binary.data(), binary.size(), polyline);
+        EXPECT_EQ(result.status, status) << binary.size();
+        EXPECT_EQ(result.position, position) << binary.size();
+        EXPECT_EQ(result.pointCount, count) << binary.size();
+        EXPECT_EQ(polyline.size(), count) << binary.size();
+    };
+
+    expectResult(std::string(), Status::Incomplete, 0, 0);
+    expectResult(std::string(1, '\x02'), Status::InvalidCharacter, 0, 0);
+    expectResult(std::string("\x00\x02\x04", 3), Status::Ok, 3, 1);
+    expectResult(std::string("\x00\x02\x04\x02\x84", 5), Status::Incomplete, 4, 1);
+    expectResult(std::string("\x00\x02\x04\x02", 4), Status::Incomplete, 4, 1);
+    expectResult(std::string("\x00\x02\x04\xff\xff\xff\xff\x10\x00", 9), Status::Overflow, 7, 1);
+    // 90.00001 degrees latitude.
+    expectResult(std::string("\x00\x82\xd1\xca\x08\x00", 6), Status::OutOfRange, 1, 0);
+
+    EXPECT_TRUE(Binary::decodeE5(std::string("\x01\x02", 2)).empty());
+    EXPECT_TRUE(Binary::toPolyline(std::string("\x01\x02", 2)).empty());
+    EXPECT_TRUE(Binary::fromPolyline("_p~iF~ps|U_ulL").empty());
+}
+
+// A random walk of fixed-point points around the given start.
+gepaf::PolylineEncoder<>::PolylineE5 randomTrack(std::mt19937 &generator, size_t size, int32_t lat, int32_t lon)
+{
+    std::uniform_int_distribution<int32_t> step(-2000, 2000);
+
+    gepaf::PolylineEncoder<>::PolylineE5 polyline;
+    for (size_t i = 0; i < size; ++i) {
+        lat = std::max(-9000000, std::min(9000000, lat + step(generator)));
+        lon = std::max(-18000000, std::min(18000000, lon + step(generator)));
+        polyline.push_back(gepaf::PolylineEncoder<>::PointE5{ lat, lon });
+    }
+    return polyline;
+}
+
+TEST(Index, RandomAccess)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+    using Index = gepaf::PolylineIndex<>;
+
+    std::mt19937 generator(22);
+    const auto polyline = randomTrack(generator, 1000, 4720000, 1660000);
+    const auto encoded = Encoder::encodeE5(polyline);
+
+    for (size_t blockSize : { 1, 7, 64, 5000 }) {
+        Index index;
+        EXPECT_TRUE(index.build(encoded, blockSize));
+        EXPECT_EQ(index.pointCount(), polyline.size());
+        EXPECT_EQ(index.blocks().size(), (polyline.size() + blockSize - 1) / blockSize);
+
+        for (size_t i = 0; i < polyline.size(); i += 13) {
+            Encoder::PointE5 point{ 0, 0 };
+            ASSERT_TRUE(index.point(encoded.data(), encoded.size(), i, point));
+            EXPECT_EQ(point.latitude, polyline[i].latitude);
+            EXPECT_EQ(point.longitude, polyline[i].longitude);
+        }
+
+        Encoder::PolylineE5 window;
+        EXPECT_TRUE(index.decode(encoded.data(), encoded.size(), 250, 321, window));
+        ASSERT_EQ(window.size(), 71);
+        EXPECT_EQ(window.front().latitude, polyline[250].latitude);
+        EXPECT_EQ(window.back().longitude, polyline[320].longitude);
+
+        // The range is clamped.
+        window.clear();
+        EXPECT_TRUE(index.decode(encoded.data(), encoded.size(), 990, 2000, window));
+        EXPECT_EQ(window.size(), 10);
+
+        Encoder::PointE5 point{ 0, 0 };
+        EXPECT_FALSE(index.point(encoded.data(), encoded.size(), polyline.size(), point));
+        EXPECT_FALSE(index.point(encoded.data(), encoded.size() - 1, 0, point));
+    }
+
+    // Invalid polylines are not indexed.
+    Index index;
+    const auto result = index.build("_p~iF~ps|U_ulLnnqC_mqN");
+    EXPECT_EQ(result.status, Encoder::Status::Incomplete);
+    EXPECT_EQ(result.position, 22);
+    EXPECT_EQ(index.pointCount(), 0);
+    EXPECT_TRUE(index.blocks().empty());
+}
+
+TEST(Index, Boxes)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+    using Index = gepaf::PolylineIndex<>;
+
+    std::mt19937 generator(23);
+    const auto polyline = randomTrack(generator, 1000, 0, 0);
+    const auto encoded = Encoder::encodeE5(polyline);
+
+    Index index;
+    ASSERT_TRUE(index.build(encoded, 50));
+
+    Encoder::BoundingBox expected;
+    ASSERT_TRUE(Encoder::bbox(encoded, expected));
+    const auto bounds = index.bounds();
+    EXPECT_EQ(bounds.min.latitude, expected.min.latitude);
+    EXPECT_EQ(bounds.max.longitude, expected.max.longitude);
+
+    // Each block covers its points and the segment into it.
+    const auto &blocks = index.blocks();
+    for (size_t i = 0; i < polyline.size(); ++i) {
+        const auto &box = blocks[i / 50].box;
+        const Encoder::BoundingBox point{ polyline[i], polyline[i] };
+        EXPECT_TRUE(Index::intersects(box, point));
+        if (i % 50 == 49 && i + 1 < polyline.size()) {
+            EXPECT_TRUE(Index::intersects(blocks[i / 50 + 1].box, point));
+        }
+    }
+
+    const Encoder::BoundingBox window{ polyline[420], polyline[420] };
+    std::vector<size_t> found;
+    index.query(window, found);
+    EXPECT_NE(std::find(found.begin(), found.end(), 8), found.end());
+    for (auto block : found) {
+        EXPECT_TRUE(Index::intersects(blocks[block].box, window));
+    }
+}
+
+TEST(Index, Sidecar)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+    using Index = gepaf::PolylineIndex<>;
+
+    std::mt19937 generator(24);
+    const auto polyline = randomTrack(generator, 500, -4720000, -1660000);
+    const auto encoded = Encoder::encodeE5(polyline);
+
+    Index index;
+    ASSERT_TRUE(index.build(encoded, 32));
+    std::string sidecar;
+    index.serialize(sidecar);
+
+    Index restored;
+    ASSERT_TRUE(restored.deserialize(sidecar.data(), sidecar.size()));
+    EXPECT_EQ(restored.pointCount(), index.pointCount());
+    EXPECT_EQ(restored.blockSize(), 32);
+    ASSERT_EQ(restored.blocks().size(), index.blocks().size());
+    for (size_t i = 0; i < index.blocks().size(); ++i) {
+        EXPECT_EQ(restored.blocks()[i].offset, index.blocks()[i].offset);
+        EXPECT_EQ(restored.blocks()[i].previous.longitude, index.blocks()[i].previous.longitude);
+        EXPECT_EQ(restored.blocks()[i].box.min.latitude, index.blocks()[i].box.min.latitude);
+    }
+
+    Encoder::PointE5 point{ 0, 0 };
+    ASSERT_TRUE(restored.point(encoded.data(), encoded.size(), 499, point));
+    EXPECT_EQ(point.latitude, polyline[499].latitude);
+
+    // Truncated, corrupted and foreign indices are rejected.
+    EXPECT_FALSE(restored.deserialize(sidecar.data(), sidecar.size() - 1));
+    EXPECT_EQ(restored.pointCount(), 0);
+    EXPECT_FALSE(restored.deserialize("GPI0", 4));
+    auto corrupted = sidecar;
+    corrupted[40] = corrupted[72];
+    EXPECT_FALSE(restored.deserialize(corrupted.data(), corrupted.size()));
+    EXPECT_FALSE(gepaf::PolylineIndex<6>().deserialize(sidecar.data(), sidecar.size()));
+
+    // A header with the largest point count and no blocks, the block count must not wrap around.
+    std::string crafted(sidecar.data(), 16);               // Magic, digits and string size.
+    crafted.append("\xff\xff\xff\xff\xff\xff\xff\xff", 8); // Point count.
+    crafted.append("\x02\x00\x00\x00\x00\x00\x00\x00", 8); // Block size.
+    crafted.append(8, '\0');                               // Block count.
+    EXPECT_FALSE(restored.deserialize(crafted.data(), crafted.size()));
+    EXPECT_FALSE(restored.point(encoded.data(), encoded.size(), 5, point));
+
+    // A string of the indexed size, but with other points, is not decoded into garbage.
+    ASSERT_TRUE(restored.deserialize(sidecar.data(), sidecar.size()));
+    std::string other = Encoder::encodeE5({ { 8900000, 0 }, { 9100000, 0 } });
+    other.resize(encoded.size(), '?');
+    EXPECT_FALSE(restored.point(other.data(), other.size(), 1, point));
+    Encoder::PolylineE5 points;
+    EXPECT_FALSE(restored.decode(other.data(), other.size(), 0, 2, points));
+}
+
+TEST(Index, RTree)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+    using Index = gepaf::PolylineIndex<>;
+
+    std::mt19937 generator(25);
+    std::uniform_int_distribution<int32_t> latitudes(-8000000, 8000000);
+    std::uniform_int_distribution<int32_t> longitudes(-17000000, 17000000);
+
+    // Many polylines, each indexed by blocks.
+    std::vector<Index> indices(200);
+    gepaf::PolylineRTree<> tree;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        const auto encoded = Encoder::encodeE5(randomTrack(generator, 300, latitudes(generator),
+                                                           longitudes(generator)));
+        ASSERT_TRUE(indices[i].build(encoded, 16));
+        tree.add(i, indices[i]);
+    }
+    tree.build();
+    EXPECT_EQ(tree.size(), 200 * 19);
+
+    for (int query = 0; query < 100; ++query) {
+        const Encoder::PointE5 corner{ latitudes(generator), longitudes(generator) };
+        const Encoder::BoundingBox viewport{ corner, Encoder::PointE5{ corner.latitude + 500000,
+                                                                       corner.longitude + 1000000 } };
+
+        std::vector<std::pair<size_t, size_t>> expected;
+        for (size_t i = 0; i < indices.size(); ++i) {
+            for (size_t block = 0; block < indices[i].blocks().size(); ++block) {
+                if (Index::intersects(indices[i].blocks()[block].box, viewport)) {
+                    expected.emplace_back(i, block);
+                }
+            }
+        }
+
+        std::vector<std::pair<size_t, size_t>> found;
+        for (const auto &entry : tree.query(viewport)) {
+            found.emplace_back(entry.polyline, entry.block);
+        }
+        std::sort(found.begin(), found.end());
+        EXPECT_EQ(found, expected);
+    }
+
+    // Trees of a single box or none.
+    gepaf::PolylineRTree<> single;
+    single.build();
+    EXPECT_TRUE(single.query(Encoder::BoundingBox{ { 0, 0 }, { 0, 0 } }).empty());
+    single.add(7, 0, Encoder::BoundingBox{ { 0, 0 }, { 10, 10 } });
+    single.build();
+    ASSERT_EQ(single.query(Encoder::BoundingBox{ { 5, 5 }, { 20, 20 } }).size(), 1);
+    EXPECT_TRUE(single.query(Encoder::BoundingBox{ { 11, 5 }, { 20, 20 } }).empty());
+}
+
+#ifdef POLYLINEENCODER_ENABLE_STATS
+TEST(Stats, Counters)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+    using Stats = gepaf::PolylineStats;
+
+    Stats::reset();
+    auto stats = Stats::snapshot();
+    EXPECT_EQ(stats.encodeCalls, 0);
+    EXPECT_EQ(stats.decodeCalls, 0);
+
+    // The values are of 4 and 5 characters.
+    const auto encoded = Encoder::encode(Encoder::decode("_p~iF~ps|U_ulLnnqC_mqNvxq`@"));
+    stats = Stats::snapshot();
+    EXPECT_EQ(stats.encodeCalls, 1);
+    EXPECT_EQ(stats.encodedPoints, 3);
+    EXPECT_EQ(stats.encodedBytes, encoded.size());
+    EXPECT_EQ(stats.valueSizes[4] + stats.valueSizes[5], 6);
+    EXPECT_EQ(stats.decodeCalls, 1);
+    EXPECT_EQ(stats.decodedPoints, 3);
+    EXPECT_EQ(stats.decodedBytes, encoded.size());
+
+    Encoder encoder(false);
+    encoder.addPoint(38.5, -120.2);
+    encoder.addPoint(40.7, -120.95);
+    EXPECT_EQ(Stats::snapshot().encodedPoints, 5);
+
+    EXPECT_FALSE(Encoder::validate("_p~iF~ps|U_ulL"));
+    EXPECT_FALSE(Encoder::validate("_p~iF~ps|U_ulL nnqC"));
+    EXPECT_FALSE(Encoder::validate("~~~~~~B?"));
+    stats = Stats::snapshot();
+    EXPECT_EQ(stats.rejected[static_cast<int>(Encoder::Status::Incomplete)], 1);
+    EXPECT_EQ(stats.rejected[static_cast<int>(Encoder::Status::InvalidCharacter)], 1);
+    EXPECT_EQ(stats.rejected[static_cast<int>(Encoder::Status::OutOfRange)], 1);
+    EXPECT_EQ(stats.decodeCalls, 4);
+
+    const auto dump = Stats::dump();
+    EXPECT_NE(dump.find("encode.points 5\n"), std::string::npos);
+    EXPECT_NE(dump.find("decode.rejected.incomplete 1\n"), std::string::npos);
+}
+
+TEST(Stats, Threads)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+    using Stats = gepaf::PolylineStats;
+
+    Stats::reset();
+
+    // The counts of finished threads are kept.
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([]() {
+            for (int j = 0; j < 100; ++j) {
+                Encoder::decode("_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    const auto stats = Stats::snapshot();
+    EXPECT_EQ(stats.decodeCalls, 400);
+    EXPECT_EQ(stats.decodedPoints, 1200);
+
+    // The blocks of finished threads are taken over, thread after thread.
+    const auto blocks = Stats::blockCount();
+    for (int i = 0; i < 20; ++i) {
+        std::thread([]() { Encoder::decode("_p~iF~ps|U"); }).join();
+    }
+    EXPECT_EQ(Stats::blockCount(), blocks);
+    EXPECT_EQ(Stats::snapshot().decodeCalls, 420);
+}
+#endif
+
+TEST(Differential, Edges)
+{
+    using Differential = gepaf::PolylineDifferential<>;
+
+    // The limits, their neighbors out of range and the longest values.
+    EXPECT_EQ(Differential::checkEncode({ { 9000000, 18000000 }, { -9000000, -18000000 }, { 0, 0 } }), "");
+    EXPECT_EQ(Differential::checkEncode({ { INT32_MAX, INT32_MIN }, { INT32_MIN, INT32_MAX } }), "");
+
+    const char *inputs[] = { "", "_p~iF~ps|U_ulLnnqC_mqNvxq`@", "_p~iF~ps|U_ulL", "_p~iF~ps|U_", "~~~~~~~~", "__________",
+                             "~~~~~~B?", "~~~~~~C?", "~~~~~~D?", "_ibE_seK", "_ibE_seK@?", "?? ??", "_p~iF~ps|U" };
+    for (const char *input : inputs) {
+        EXPECT_EQ(Differential::checkDecode(input, std::strlen(input)), "") << input;
+    }
+
+    // Edits of polylines with invalid, out-of-range and redundantly encoded points.
+    for (const char *input : inputs) {
+        for (const char *other : { "", "_p~iF~ps|U", "_p~iF~ps|U_ul", "_p~iF~ps|U !!", "~?~?_wemJ?" }) {
+            for (size_t begin = 0; begin < 4; ++begin) {
+                EXPECT_EQ(Differential::checkEdit(input, other, begin, begin + 2), "") << input << ' ' << other;
+                EXPECT_EQ(Differential::checkEdit(input, other, begin + 1, begin), "") << input << ' ' << other;
+            }
+        }
+    }
+}
+
+TEST(Differential, Long)
+{
+    using Differential = gepaf::PolylineDifferential<>;
+
+    // Long enough for the parallel decoding, valid and mutated ones.
+    std::mt19937 generator(3);
+    for (int i = 0; i < 4; ++i) {
+        const auto points = Differential::makePoints(generator, Differential::Kind::Long);
+        const auto coords = Differential::makeString(generator, Differential::Kind::Long, points);
+        EXPECT_GE(Differential::referenceEncode(points).size(), 1u << 16);
+        EXPECT_EQ(Differential::checkEncode(points), "");
+        EXPECT_EQ(Differential::checkDecode(coords.data(), coords.size()), "") << i;
+    }
+}
+
+TEST(Differential, Random)
+{
+    std::mt19937 generator(1);
+    size_t bytes = 0;
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(gepaf::checkDifferential(generator, bytes), "") << i;
+    }
+}
+
+// The reference recursive Douglas-Peucker simplification in the fixed-point space.
+void referenceSimplify(const gepaf::PolylineEncoder<>::PolylineE5 &points, size_t first, size_t last,
+                       double tolerance, std::vector<bool> &keep)
+{
+    size_t farthest = 0;
+    double maxDistance = tolerance;
+    for (size_t i = first + 1; i < last; ++i) {
+        // The distance to the segment.
+        const double ax = points[first].longitude, ay = points[first].latitude;
+        const double bx = points[last].longitude, by = points[last].latitude;
+        const double px = points[i].longitude, py = points[i].latitude;
+        const double length = (bx - ax) * (bx - ax) + (by - ay) * (by - ay);
+        double t = length > 0 ? ((px - ax) * (bx - ax) + (py - ay) * (by - ay)) / length : 0;
+        t = std::max(0.0, std::min(1.0, t));
+        const double distance = std::hypot(px - ax - t * (bx - ax), py - ay - t * (by - ay));
+        if (distance > maxDistance) {
+            maxDistance = distance;
+            farthest = i;
+        }
+    }
+    if (farthest != 0) {
+        keep[farthest] = true;
+        referenceSimplify(points, first, farthest, tolerance, keep);
+        referenceSimplify(points, farthest, last, tolerance, keep);
+    }
+}
+
+TEST(Simplify, Basic)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    // Points on a straight line.
+    const Encoder::Polyline line = { { 0.0, 0.0 }, { 1.0, 1.0 }, { 2.0, 2.0 }, { 3.0, 3.0 } };
+    EXPECT_EQ(Encoder::encodeSimplified(line, 0.0), Encoder::encode(Encoder::Polyline{ line[0], line[3] }));
+
+    // The corner is farther than the tolerance.
+    const Encoder::Polyline corner = { { 0.0, 0.0 }, { 0.5, 0.0 }, { 1.0, 0.0 }, { 1.0, 1.0 } };
+    EXPECT_EQ(Encoder::encodeSimplified(corner, 0.1), Encoder::encode(Encoder::Polyline{ corner[0], corner[2], corner[3] }));
+    EXPECT_EQ(Encoder::encodeSimplified(corner, 1.0), Encoder::encode(Encoder::Polyline{ corner[0], corner[3] }));
+
+    // Too short polylines and closed rings.
+    EXPECT_EQ(Encoder::encodeSimplified(Encoder::Polyline{}, 1.0), "");
+    EXPECT_EQ(Encoder::encodeSimplified(Encoder::Polyline{ corner[3] }, 1.0), Encoder::encode(Encoder::Polyline{ corner[3] }));
+    const Encoder::Polyline ring = { { 0.0, 0.0 }, { 0.0, 1.0 }, { 1.0, 1.0 }, { 0.0, 0.0 } };
+    EXPECT_EQ(Encoder::encodeSimplified(ring, 0.1), Encoder::encode(ring));
+
+    // Appending.
+    std::string result = "prefix";
+    Encoder::encodeSimplified(line, 0.0, result);
+    EXPECT_EQ(result, "prefix" + Encoder::encode(Encoder::Polyline{ line[0], line[3] }));
+}
+
+TEST(Simplify, MatchesRecursive)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    std::mt19937 generator(3);
+    std::normal_distribution<double> step(0.0, 0.01);
+    for (double tolerance : { 0.0, 0.001, 0.01, 0.1 }) {
+        Encoder::PolylineE5 polyline;
+        double lat = 10.0;
+        double lon = 20.0;
+        for (int i = 0; i < 5000; ++i) {
+            lat += step(generator);
+            lon += step(generator);
+            polyline.push_back({ Encoder::toE5(lat), Encoder::toE5(lon) });
+        }
+
+        std::vector<bool> keep(polyline.size(), false);
+        keep.front() = keep.back() = true;
+        referenceSimplify(polyline, 0, polyline.size() - 1, tolerance * Encoder::Precision::Value, keep);
+
+        Encoder::PolylineE5 expected;
+        for (size_t i = 0; i < polyline.size(); ++i) {
+            if (keep[i]) {
+                expected.push_back(polyline[i]);
+            }
+        }
+        const auto simplified = Encoder::encodeSimplifiedE5(polyline, tolerance);
+        EXPECT_EQ(simplified, Encoder::encodeE5(expected)) << tolerance;
+        EXPECT_LE(simplified.size(), Encoder::encodeE5(polyline).size());
+    }
+}
+
+#ifdef POLYLINEENCODER_CXX17
+TEST(Constexpr, EncodeDecode)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    constexpr auto encoded = Encoder::encodeFixed({ { 38.5, -120.2 }, { 40.7, -120.95 }, { 43.252, -126.453 } });
+    static_assert(encoded.view() == "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+
+    constexpr auto encodedE5 = Encoder::encodeFixedE5({ { -9000000, -18000000 }, { 0, 0 }, { 9000000, 18000000 } });
+    static_assert(encodedE5.view() == "~bidP~fsia@_cidP_gsia@_cidP_gsia@");
+
+    constexpr auto decoded = Encoder::decodeFixed<4>("_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+    static_assert(decoded.result && decoded.size() == 3);
+    static_assert(decoded[1].latitude == 4070000 && decoded[1].longitude == -12095000);
+    static_assert(decoded.latitude(2) == 43.252);
+
+    // The same errors as at run time.
+    static_assert(Encoder::decodeFixed<2>("_p~iF~ps|U_ulLnnqC_mqNvxq`@").result.status == Encoder::Status::Overflow);
+    static_assert(Encoder::decodeFixed<4>("_p~iF~ps|U_ul").result.status == Encoder::Status::Incomplete);
+    static_assert(Encoder::decodeFixed<4>("_p~iF~ps|U_ul").result.position == 10);
+    static_assert(Encoder::encodeFixed({ { 90.5, 0.0 } }).size == 0);
+
+    EXPECT_EQ(std::string(encoded.data), Encoder::encode({ { 38.5, -120.2 }, { 40.7, -120.95 }, { 43.252, -126.453 } }));
+}
+
+TEST(Constexpr, MatchesRuntime)
+{
+    using Encoder = gepaf::PolylineEncoder<>;
+
+    // Rounding without std::round() gives the same results, including the halves.
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<double> lat(-90.0, 90.0);
+    std::uniform_real_distribution<double> lon(-180.0, 180.0);
+    std::uniform_int_distribution<int> half(-18000000, 18000000);
+    for (int n = 0; n < 1000; ++n) {
+        const double points[3][2] = { { lat(generator), lon(generator) },
+                                      { half(generator) / 2 / 1e5 + 0.000005, half(generator) / 1e5 - 0.000005 },
+                                      { -0.000005, 0.000015 } };
+        const Encoder::Polyline polyline = { { points[0][0], points[0][1] },
+                                             { points[1][0], points[1][1] },
+                                             { points[2][0], points[2][1] } };
+        EXPECT_EQ(Encoder::encodeFixed(points).view(), Encoder::encode(polyline));
+
+        const auto decoded = Encoder::decodeFixed<3>(Encoder::encode(polyline));
+        const auto expected = Encoder::decodeE5(Encoder::encode(polyline));
+        ASSERT_EQ(decoded.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(decoded[i].latitude, expected[i].latitude);
+            EXPECT_EQ(decoded[i].longitude, expected[i].longitude);
+        }
+    }
+}
+#endif
+
 int main(int argc, char** argv)
 {
     testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,271 @@
+/*
+MIT License
+
+Copyright (c) 2017 Vahan Aghajanyan <vahancho@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// polyline-cat: encodes, decodes and validates newline-delimited polylines.
+//
+// The encoded files have one encoded polyline per line. The decoded files have
+// one polyline per line too, as space separated "latitude,longitude" pairs.
+
+#include "polylinefile.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace
+{
+
+void printUsage()
+{
+    std::fprintf(stderr,
+                 "Usage: polyline-cat [-p DIGITS] COMMAND [INPUT [OUTPUT]]\n"
+                 "\n"
+                 "Commands:\n"
+                 "  decode    Decode encoded polylines into coordinates\n"
+                 "  encode    Encode coordinates into encoded polylines\n"
+                 "  validate  Check encoded polylines and report the errors\n"
+                 "\n"
+                 "Options:\n"
+                 "  -p DIGITS The precision, 1 to 7 decimal places (default: 5)\n"
+                 "\n"
+                 "The standard input and output are used if no files are given or they are '-'.\n");
+}
+
+template<typename Status>
+const char *statusText(Status status)
+{
+    switch (status) {
+    case Status::Ok:               return "ok";
+    case Status::Incomplete:       return "incomplete value";
+    case Status::InvalidCharacter: return "invalid character";
+    case Status::Overflow:         return "value overflow";
+    case Status::OutOfRange:       return "coordinate out of range";
+    }
+    return "unknown error";
+}
+
+//! The input, either memory-mapped or read from the standard input.
+struct Input
+{
+    gepaf::MappedFile file;
+    std::string buffer;
+
+    bool open(const std::string &path)
+    {
+        if (path != "-") {
+            return file.open(path);
+        }
+
+        char chunk[1 << 16];
+        size_t size = 0;
+        while ((size = std::fread(chunk, 1, sizeof(chunk), stdin)) > 0) {
+            buffer.append(chunk, size);
+        }
+        return !std::ferror(stdin);
+    }
+
+    const char *data() const { return file.isOpen() ? file.data() : buffer.data(); }
+    size_t size() const { return file.isOpen() ? file.size() : buffer.size(); }
+};
+
+template<typename Result>
+void reportError(size_t line, const Result &result)
+{
+    std::fprintf(stderr, "line %zu: %s at position %zu\n", line, statusText(result.status), result.position);
+}
+
+template<int Digits>
+int decode(const Input &input, gepaf::PolylineWriter<Digits> &output)
+{
+    gepaf::PolylineReader<Digits> reader(input.data(), input.size());
+    typename gepaf::PolylineEncoder<Digits>::Polyline points;
+    typename gepaf::PolylineEncoder<Digits>::Result result{};
+
+    int exitCode = EXIT_SUCCESS;
+    char number[64];
+    std::string line;
+    while (reader.next(points, result)) {
+        if (!result) {
+            reportError(reader.lineNumber(), result);
+            exitCode = EXIT_FAILURE;
+        }
+
+        line.clear();
+        for (size_t i = 0; i < points.size(); ++i) {
+            const int size = std::snprintf(number, sizeof(number), i == 0 ? "%.*f,%.*f" : " %.*f,%.*f",
+                                           Digits, points[i].latitude(), Digits, points[i].longitude());
+            line.append(number, static_cast<size_t>(size));
+        }
+        output.write(line.data(), line.size());
+    }
+    return exitCode;
+}
+
+//! Parses the "latitude,longitude" pairs of the null-terminated \p line.
+/*!
+    \returns false if the line is malformed or a coordinate is not a finite number
+             within ±90.0° latitude and ±180.0° longitude.
+*/
+template<int Digits>
+bool parseLine(const char *line, typename gepaf::PolylineEncoder<Digits>::Polyline &points)
+{
+    points.clear();
+    for (;;) {
+        while (*line == ' ' || *line == '\t') {
+            ++line;
+        }
+        if (*line == '\0') {
+            return true;
+        }
+
+        char *end = nullptr;
+        const double latitude = std::strtod(line, &end);
+        if (end == line || *end != ',') {
+            return false;
+        }
+        line = end + 1;
+        const double longitude = std::strtod(line, &end);
+        if (end == line || (*end != ' ' && *end != '\t' && *end != '\0')) {
+            return false;
+        }
+        line = end;
+        // The comparisons are false for NaNs too.
+        if (!(latitude >= -90.0 && latitude <= 90.0 && longitude >= -180.0 && longitude <= 180.0)) {
+            return false;
+        }
+        points.emplace_back(latitude, longitude);
+    }
+}
+
+template<int Digits>
+int encode(const Input &input, gepaf::PolylineWriter<Digits> &output)
+{
+    // The lines are read as encoded records, but only the line splitting is used.
+    gepaf::PolylineReader<Digits> reader(input.data(), input.size());
+    gepaf::PolylineView<Digits> record;
+    typename gepaf::PolylineEncoder<Digits>::Polyline points;
+    std::string line;
+
+    int exitCode = EXIT_SUCCESS;
+    while (reader.next(record)) {
+        line.assign(record.data(), record.size());
+        if (!parseLine<Digits>(line.c_str(), points)) {
+            std::fprintf(stderr, "line %zu: invalid coordinates\n", reader.lineNumber());
+            exitCode = EXIT_FAILURE;
+            points.clear();
+        }
+        output.write(points);
+    }
+    return exitCode;
+}
+
+template<int Digits>
+int validate(const Input &input, gepaf::PolylineWriter<Digits> &output)
+{
+    gepaf::PolylineReader<Digits> reader(input.data(), input.size());
+    gepaf::PolylineView<Digits> record;
+
+    size_t invalid = 0;
+    while (reader.next(record)) {
+        const auto result = gepaf::PolylineEncoder<Digits>::validate(record.data(), record.size());
+        if (!result) {
+            reportError(reader.lineNumber(), result);
+            ++invalid;
+        }
+    }
+
+    char summary[128];
+    const int size = std::snprintf(summary, sizeof(summary), "%zu records, %zu invalid",
+                                   reader.lineNumber(), invalid);
+    output.write(summary, static_cast<size_t>(size));
+    return invalid == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+template<int Digits>
+int run(const std::string &command, const Input &input, const std::string &outputPath)
+{
+    gepaf::PolylineWriter<Digits> output(outputPath == "-" ? stdout : nullptr);
+    if (!output.isOpen() && !output.open(outputPath)) {
+        std::fprintf(stderr, "polyline-cat: cannot write %s\n", outputPath.c_str());
+        return EXIT_FAILURE;
+    }
+
+    int exitCode = EXIT_FAILURE;
+    if (command == "decode") {
+        exitCode = decode<Digits>(input, output);
+    } else if (command == "encode") {
+        exitCode = encode<Digits>(input, output);
+    } else {
+        exitCode = validate<Digits>(input, output);
+    }
+
+    if (!output.close()) {
+        std::fprintf(stderr, "polyline-cat: cannot write %s\n", outputPath.c_str());
+        return EXIT_FAILURE;
+    }
+    return exitCode;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int digits = 5;
+    int arg = 1;
+    if (arg + 1 < argc && std::strcmp(argv[arg], "-p") == 0) {
+        digits = std::atoi(argv[arg + 1]);
+        arg += 2;
+    }
+
+    if (arg >= argc || digits < 1 || digits > 7) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    const std::string command = argv[arg++];
+    if (command != "decode" && command != "encode" && command != "validate") {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    const std::string inputPath = arg < argc ? argv[arg++] : "-";
+    const std::string outputPath = arg < argc ? argv[arg++] : "-";
+
+    Input input;
+    if (!input.open(inputPath)) {
+        std::fprintf(stderr, "polyline-cat: cannot read %s\n", inputPath.c_str());
+        return EXIT_FAILURE;
+    }
+
+    switch (digits) {
+    case 1: return run<1>(command, input, outputPath);
+    case 2: return run<2>(command, input, outputPath);
+    case 3: return run<3>(command, input, outputPath);
+    case 4: return run<4>(command, input, outputPath);
+    case 5: return run<5>(command, input, outputPath);
+    case 6: return run<6>(command, input, outputPath);
+    default: return run<7>(command, input, outputPath);
+    }
+}